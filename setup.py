@@ -113,7 +113,7 @@ def setup_package():
         version=about["__version__"],
         ext_modules=ext_modules,
         cmdclass={"build_ext": build_ext_subclass},
-        package_data={"": ["*.pyx", "*.pxd", "*.pxi", "*.cpp", "*.cu"]},
+        package_data={"": ["*.pyx", "*.pxd", "*.pxi", "*.cpp", "*.h", "*.cu"]},
     )
 
 
@@ -3,10 +3,17 @@ from .initializers import normal_init, uniform_init, glorot_uniform_init, zero_i
 from .loss import CategoricalCrossentropy, L2Distance, CosineDistance
 from .loss import SequenceCategoricalCrossentropy
 from .model import Model, serialize_attr, deserialize_attr
-from .model import set_dropout_rate, change_attr_values
+from .model import set_dropout_rate, change_attr_values, no_grad
 from .shims import Shim, PyTorchShim, TensorFlowShim, keras_model_fns, MXNetShim
 from .shims import maybe_handshake_model
 from .optimizers import Adam, RAdam, SGD, Optimizer
+from .parallel import DataParallel, set_thread_pool_size
+from .serving import BatchingExecutor
+from .profiler import profile_model, Profiler
+from .quantization import quantize_int8, compare_predictions
+from .pruning import MagnitudePruner, sparsify
+from .precision import Precision, mixed_precision, use_precision
+from .precision import get_current_precision, set_current_precision
 from .schedules import cyclic_triangular, warmup_linear, constant, constant_then
 from .schedules import decaying, slanted_triangular, compounding
 from .types import Ragged, Padded, ArgsKwargs
@@ -17,11 +24,12 @@ from .util import torch2xp, xp2torch, tensorflow2xp, xp2tensorflow, mxnet2xp, xp
 from .backends import get_ops, set_current_ops, get_current_ops, use_ops
 from .backends import Ops, CupyOps, NumpyOps, JaxOps, has_cupy, has_jax
 from .backends import use_pytorch_for_gpu_memory, use_tensorflow_for_gpu_memory
+from .backends import track_memory, MemoryTracker
 
 from .layers import Dropout, Embed, expand_window, HashEmbed, LayerNorm, Linear
 from .layers import Maxout, Mish, MultiSoftmax, Relu, Softmax, LSTM
 from .layers import CauchySimilarity, ParametricAttention, Logistic
-from .layers import SparseLinear, StaticVectors, FeatureExtractor
+from .layers import SparseLinear, StaticVectors, FeatureExtractor, WindowedMaxout
 from .layers import PyTorchWrapper, PyTorchRNNWrapper, PyTorchLSTM
 from .layers import TensorFlowWrapper, keras_subclass, MXNetWrapper
 
@@ -31,7 +39,7 @@ from .layers import with_array, with_padded, with_list, with_ragged, with_flatte
 from .layers import with_reshape, with_getitem, strings2arrays, list2array
 from .layers import list2ragged, ragged2list, list2padded, padded2list, remap_ids
 from .layers import array_getitem
-from .layers import with_debug
+from .layers import with_debug, with_checkpoint, with_precision
 
 from .layers import reduce_max, reduce_mean, reduce_sum
 
@@ -9,6 +9,7 @@ from .numpy_ops import NumpyOps
 from .jax_ops import JaxOps, has_jax, jax_jit
 from ._cupy_allocators import cupy_tensorflow_allocator, cupy_pytorch_allocator
 from ._param_server import ParamServer
+from ._memory import MemoryTracker, track_memory
 from ..util import assert_tensorflow_installed, assert_pytorch_installed
 from ..types import OpsNames
 
@@ -83,6 +84,8 @@ __all__ = [
     "use_ops",
     "jax_jit",
     "ParamServer",
+    "MemoryTracker",
+    "track_memory",
     "Ops",
     "CupyOps",
     "NumpyOps",
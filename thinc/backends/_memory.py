@@ -0,0 +1,186 @@
+from typing import Any, Dict, Iterator, List, Optional, Tuple
+from collections import Counter
+import contextlib
+import threading
+import weakref
+from wasabi import table
+
+from ..util import format_bytes
+
+
+# The tracker that's currently recording allocations, if any. The Ops check
+# this before doing anything else, so tracking costs a single attribute
+# lookup per allocation while it's disabled.
+active_tracker: Optional["MemoryTracker"] = None
+
+
+class MemoryTracker:
+    """Account for the arrays allocated through the `alloc*` and `asarray*`
+    methods of the Ops, attributing each one to the model node that was
+    executing when it was created. While a tracker is active, Model.__call__
+    runs the forward function through `tracker.call`, which maintains the node
+    stack for both the forward and the backward pass. Subclasses can override
+    `call` and `track` to collect other stats per node, like the Profiler.
+
+    The tracker reports the live bytes (arrays that haven't been freed yet),
+    the peak live bytes, and the nodes that held the most memory at the
+    peak. Call `step()` after each batch to close the current step, which
+    records its stats in `tracker.steps` and resets the peak.
+    """
+
+    def __init__(self, *, top_k: int = 10):
+        self.top_k = top_k
+        self.steps: List[Dict[str, Any]] = []
+        self.live_bytes = 0
+        self.peak_bytes = 0
+        self.allocated_bytes = 0
+        self.n_allocs = 0
+        self._live_by_node: Counter = Counter()
+        self._peak_by_node: Dict[str, int] = {}
+        self._allocated_by_node: Counter = Counter()
+        self._lock = threading.Lock()
+        self._local = threading.local()
+
+    @contextlib.contextmanager
+    def node(self, name: str) -> Iterator[Dict[str, Any]]:
+        """Attribute the allocations made in the context to a node. Yields the
+        node's frame on the stack, a dict that subclasses can add stats to.
+        """
+        frame = {"name": name}
+        stack = self._get_stack()
+        stack.append(frame)
+        try:
+            yield frame
+        finally:
+            stack.pop()
+
+    def call(self, model: Any, X: Any, is_train: bool) -> Tuple[Any, Any]:
+        """Call a model's forward function, attributing the allocations of the
+        forward and the backward pass to the model's node.
+        """
+        with self.node(model.name):
+            Y, backprop = model._func(model, X, is_train=is_train)
+
+        def tracked_backprop(dY: Any) -> Any:
+            with self.node(model.name):
+                return backprop(dY)
+
+        return Y, tracked_backprop
+
+    def track(self, array: Any) -> None:
+        """Record a new array, and watch for it to be freed."""
+        n_bytes = int(getattr(array, "nbytes", 0))
+        if not n_bytes:
+            return
+        stack = self._get_stack()
+        name = stack[-1]["name"] if stack else "<no node>"
+        try:
+            weakref.finalize(array, self._free, name, n_bytes)
+            is_watched = True
+        except TypeError:  # pragma: no cover
+            # Arrays that don't support weak references are counted as
+            # allocated, but never as live.
+            is_watched = False
+        with self._lock:
+            self.n_allocs += 1
+            self.allocated_bytes += n_bytes
+            self._allocated_by_node[name] += n_bytes
+            if is_watched:
+                self._live_by_node[name] += n_bytes
+                self.live_bytes += n_bytes
+                if self.live_bytes > self.peak_bytes:
+                    self.peak_bytes = self.live_bytes
+                    self._peak_by_node = dict(self._live_by_node)
+
+    def step(self) -> Dict[str, Any]:
+        """Close the current step, and return its stats: the peak and live
+        bytes, the bytes allocated during the step, and the top nodes by bytes
+        held at the peak and by bytes allocated.
+        """
+        with self._lock:
+            stats = {
+                "step": len(self.steps),
+                "peak_bytes": self.peak_bytes,
+                "live_bytes": self.live_bytes,
+                "allocated_bytes": self.allocated_bytes,
+                "n_allocs": self.n_allocs,
+                "peak_by_node": _top_k(self._peak_by_node, self.top_k),
+                "allocated_by_node": _top_k(self._allocated_by_node, self.top_k),
+            }
+            self.steps.append(stats)
+            self.peak_bytes = self.live_bytes
+            self._peak_by_node = dict(self._live_by_node)
+            self.allocated_bytes = 0
+            self.n_allocs = 0
+            self._allocated_by_node = Counter()
+        return stats
+
+    def format_table(self) -> str:
+        """Format the recorded steps as a text table."""
+        rows = []
+        for stats in self.steps:
+            top = ", ".join(
+                f"{name} ({format_bytes(n_bytes)})"
+                for name, n_bytes in stats["peak_by_node"][:3]
+            )
+            rows.append(
+                (
+                    stats["step"],
+                    format_bytes(stats["peak_bytes"]),
+                    format_bytes(stats["live_bytes"]),
+                    format_bytes(stats["allocated_bytes"]),
+                    stats["n_allocs"],
+                    top,
+                )
+            )
+        header = ("Step", "Peak", "Live", "Allocated", "Allocs", "Top at peak")
+        return table(rows, header=header, divider=True)
+
+    def _free(self, name: str, n_bytes: int) -> None:
+        with self._lock:
+            self.live_bytes -= n_bytes
+            self._live_by_node[name] -= n_bytes
+            if not self._live_by_node[name]:
+                del self._live_by_node[name]
+
+    def _get_stack(self) -> List[Dict[str, Any]]:
+        stack = getattr(self._local, "stack", None)
+        if stack is None:
+            stack = self._local.stack = []
+        return stack
+
+
+@contextlib.contextmanager
+def track_memory(*, top_k: int = 10) -> Iterator[MemoryTracker]:
+    """Track the allocations made through the Ops while the context is
+    active. Only one tracker can be active at a time.
+
+    EXAMPLE:
+        with track_memory() as tracker:
+            for X, Y in batches:
+                Yh, backprop = model.begin_update(X)
+                backprop(Yh - Y)
+                model.finish_update(optimizer)
+                tracker.step()
+        print(tracker.format_table())
+    """
+    with use_tracker(MemoryTracker(top_k=top_k)) as tracker:
+        yield tracker
+
+
+@contextlib.contextmanager
+def use_tracker(tracker: MemoryTracker) -> Iterator[MemoryTracker]:
+    """Make a tracker the active one while the context is active."""
+    global active_tracker
+    if active_tracker is not None:
+        raise ValueError("Memory tracking is already active")
+    active_tracker = tracker
+    try:
+        yield tracker
+    finally:
+        active_tracker = None
+
+
+def _top_k(counts: Dict[str, int], k: int) -> List[Tuple[str, int]]:
+    return sorted(counts.items(), key=lambda item: item[1], reverse=True)[:k]
+
@@ -1,4 +1,4 @@
-from typing import Dict, Tuple
+from typing import Any, Callable, Dict, Set, Tuple
 
 from ..types import FloatsXd
 
@@ -11,12 +11,18 @@ class ParamServer:
 
     _params: Dict[KeyT, FloatsXd] = {}
     _grads: Dict[KeyT, FloatsXd] = {}
+    _shared: Set[KeyT]
+    _versions: Dict[KeyT, int]
+    _packed: Dict[KeyT, Tuple[int, Any]]
 
     def __init__(
         self, params: Dict[KeyT, FloatsXd] = {}, grads: Dict[KeyT, FloatsXd] = {}
     ):
         self._params = dict(params)
         self._grads = dict(grads)
+        self._shared = set()
+        self._versions = {}
+        self._packed = {}
 
     @property
     def param_keys(self) -> Tuple[KeyT, ...]:
@@ -39,13 +45,67 @@ class ParamServer:
     def get_grad(self, model_id: int, name: str) -> FloatsXd:
         return self._grads[(model_id, name)]
 
+    def is_shared(self, model_id: int, name: str) -> bool:
+        return (model_id, name) in self._shared
+
+    def get_packed_param(
+        self, model_id: int, name: str, pack: Callable[[FloatsXd], Any]
+    ) -> Any:
+        """Get a parameter converted by the `pack` function. The result is
+        cached until the parameter's version changes, i.e. until it's set
+        again.
+        """
+        key = (model_id, name)
+        param = self._params[key]
+        version = self.get_version(model_id, name)
+        cached = self._packed.get(key)
+        if cached is None or cached[0] != version:
+            cached = (version, pack(param))
+            self._packed[key] = cached
+        return cached[1]
+
+    def get_version(self, model_id: int, name: str) -> int:
+        """Get a counter that's incremented each time the parameter is set."""
+        return self._versions.get((model_id, name), 0)
+
     def set_param(self, model_id: int, name: str, value: FloatsXd) -> None:
         self._params[(model_id, name)] = value
+        self._shared.discard((model_id, name))
+        self._bump_version(model_id, name)
+
+    def remove_param(self, model_id: int, name: str) -> None:
+        """Delete a parameter, its gradient and any packed copy of it, so that
+        the arrays can be freed.
+        """
+        key = (model_id, name)
+        self._params.pop(key, None)
+        self._grads.pop(key, None)
+        self._shared.discard(key)
+        self._bump_version(model_id, name)
+
+    def share_param(self, model_id: int, name: str, value: FloatsXd) -> None:
+        """Set a parameter to a buffer that's shared with other models. The
+        buffer is served read-only, and is copied the first time a gradient
+        is set for the parameter, so that it can be updated in place. The
+        models the buffer came from should share it too, so that updating
+        them doesn't change the other models.
+        """
+        if hasattr(value, "flags"):
+            value = value.view()
+            try:
+                value.flags.writeable = False
+            except (AttributeError, ValueError):  # pragma: no cover
+                pass
+        self._params[(model_id, name)] = value
+        self._shared.add((model_id, name))
+        self._bump_version(model_id, name)
 
     def set_grad(self, model_id: int, name: str, value: FloatsXd) -> None:
+        self.unshare(model_id, name)
         self._grads[(model_id, name)] = value
 
     def inc_grad(self, model_id: int, param_name: str, value: FloatsXd) -> None:
+        self.unshare(model_id, param_name)
         if not self.has_grad(model_id, param_name):  # pragma: no cover
             # Adjustment for Jax
             if hasattr(value, "copy"):
@@ -54,3 +114,15 @@ class ParamServer:
                 self._grads[(model_id, param_name)] = value
         else:
             self._grads[(model_id, param_name)] += value
+
+    def unshare(self, model_id: int, name: str) -> None:
+        """Copy a shared parameter, so that it can be updated in place."""
+        key = (model_id, name)
+        if key in self._shared:
+            self._params[key] = self._params[key].copy()
+            self._shared.discard(key)
+
+    def _bump_version(self, model_id: int, name: str) -> None:
+        key = (model_id, name)
+        self._versions[key] = self._versions.get(key, 0) + 1
+        self._packed.pop(key, None)
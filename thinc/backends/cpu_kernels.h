@@ -0,0 +1,372 @@
+/* Native CPU kernels for NumpyOps, declared in numpy_ops.pyx. */
+#ifndef THINC_CPU_KERNELS_H
+#define THINC_CPU_KERNELS_H
+
+#include <stdint.h>
+/* Multiply the int16 rows X[i:i+n] (n <= 4) with each int8 row of W,
+   sharing the loads of W between the rows. The products are accumulated
+   in int32, which can't overflow for nI < 2**17. */
+#define THINC_GEMM_INT8_ROWS(DOT) \
+    for (int o = 0; o < nO; o++) { \
+        const int8_t* w = W + (int64_t)o * nI; \
+        int32_t acc[4] = {0, 0, 0, 0}; \
+        DOT \
+        for (int r = 0; r < n; r++) \
+            Y[(int64_t)r * nO + o] = (float)acc[r] * x_scales[r] * w_scales[o]; \
+    }
+
+static inline void cpu_gemm_int8_rows(float* Y, const int16_t* X,
+        const float* x_scales, const int8_t* W, const float* w_scales,
+        int n, int nO, int nI) {
+    THINC_GEMM_INT8_ROWS(
+        for (int r = 0; r < n; r++) {
+            const int16_t* x = X + (int64_t)r * nI;
+            for (int j = 0; j < nI; j++)
+                acc[r] += x[j] * w[j];
+        }
+    )
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define THINC_HAVE_AVX2 1
+
+__attribute__((target("avx2"), always_inline))
+static inline void cpu_gemm_int8_rows_avx2(float* Y, const int16_t* X,
+        const float* x_scales, const int8_t* W, const float* w_scales,
+        int n, int nO, int nI) {
+    THINC_GEMM_INT8_ROWS(
+        __m256i sums[4];
+        for (int r = 0; r < n; r++)
+            sums[r] = _mm256_setzero_si256();
+        int j = 0;
+        for (; j + 16 <= nI; j += 16) {
+            __m256i wv = _mm256_cvtepi8_epi16(
+                _mm_loadu_si128((const __m128i*)(w + j)));
+            for (int r = 0; r < n; r++) {
+                __m256i xv = _mm256_loadu_si256(
+                    (const __m256i*)(X + (int64_t)r * nI + j));
+                sums[r] = _mm256_add_epi32(sums[r], _mm256_madd_epi16(xv, wv));
+            }
+        }
+        for (int r = 0; r < n; r++) {
+            __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sums[r]),
+                _mm256_extracti128_si256(sums[r], 1));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+            acc[r] = _mm_cvtsi128_si32(s);
+            const int16_t* x = X + (int64_t)r * nI;
+            for (int k = j; k < nI; k++)
+                acc[r] += x[k] * w[k];
+        }
+    )
+}
+
+/* The rows are processed in blocks of four, with the block size known
+   at compile time so that the accumulators stay in registers. */
+#define THINC_GEMM_INT8_BLOCKS(ROWS) \
+    int i = 0; \
+    for (; i + 4 <= N; i += 4) \
+        ROWS(Y + (int64_t)i * nO, X + (int64_t)i * nI, x_scales + i, W, \
+            w_scales, 4, nO, nI); \
+    if (i < N) \
+        ROWS(Y + (int64_t)i * nO, X + (int64_t)i * nI, x_scales + i, W, \
+            w_scales, N - i, nO, nI);
+
+__attribute__((target("avx2")))
+static void cpu_gemm_int8_avx2(float* Y, const int16_t* X,
+        const float* x_scales, const int8_t* W, const float* w_scales,
+        int N, int nO, int nI) {
+    THINC_GEMM_INT8_BLOCKS(cpu_gemm_int8_rows_avx2)
+}
+#endif
+
+/* The AVX2 version is used if the CPU supports it, with a portable
+   version as the fallback. */
+static void cpu_gemm_int8(float* Y, const int16_t* X, const float* x_scales,
+        const int8_t* W, const float* w_scales, int N, int nO, int nI) {
+#ifdef THINC_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        cpu_gemm_int8_avx2(Y, X, x_scales, W, w_scales, N, nO, nI);
+        return;
+    }
+#endif
+    THINC_GEMM_INT8_BLOCKS(cpu_gemm_int8_rows)
+}
+
+/* Products with a CSR matrix W of shape (nO, nI), on the transposed
+   inputs and outputs, so that each non-zero weight is applied to a
+   contiguous row of N values. The AVX2 versions add four non-zeros of a
+   row per pass over the output row in the forward pass, and compute the
+   gradient of a non-zero and its contribution to the gradient of the
+   input in the same pass in the backward pass. */
+static void cpu_sparse_gemm_generic(float* YT, const float* XT,
+        const float* data, const int* indices, const int* indptr,
+        int nO, int N) {
+    for (int o = 0; o < nO; o++) {
+        float* y = YT + (int64_t)o * N;
+        for (int k = indptr[o]; k < indptr[o+1]; k++) {
+            const float* x = XT + (int64_t)indices[k] * N;
+            for (int n = 0; n < N; n++)
+                y[n] += data[k] * x[n];
+        }
+    }
+}
+
+static void cpu_backprop_sparse_gemm_generic(float* dXT, float* d_data,
+        const float* dYT, const float* XT, const float* data,
+        const int* indices, const int* indptr, int nO, int N) {
+    for (int o = 0; o < nO; o++) {
+        const float* dy = dYT + (int64_t)o * N;
+        for (int k = indptr[o]; k < indptr[o+1]; k++) {
+            const float* x = XT + (int64_t)indices[k] * N;
+            float* dx = dXT + (int64_t)indices[k] * N;
+            float d = 0;
+            for (int n = 0; n < N; n++) {
+                d += x[n] * dy[n];
+                dx[n] += data[k] * dy[n];
+            }
+            d_data[k] = d;
+        }
+    }
+}
+
+#ifdef THINC_HAVE_AVX2
+__attribute__((target("avx2,fma")))
+static void cpu_sparse_gemm_avx2(float* YT, const float* XT,
+        const float* data, const int* indices, const int* indptr,
+        int nO, int N) {
+    for (int o = 0; o < nO; o++) {
+        float* y = YT + (int64_t)o * N;
+        int k = indptr[o];
+        for (; k + 4 <= indptr[o+1]; k += 4) {
+            const float* x0 = XT + (int64_t)indices[k] * N;
+            const float* x1 = XT + (int64_t)indices[k+1] * N;
+            const float* x2 = XT + (int64_t)indices[k+2] * N;
+            const float* x3 = XT + (int64_t)indices[k+3] * N;
+            __m256 w0 = _mm256_set1_ps(data[k]);
+            __m256 w1 = _mm256_set1_ps(data[k+1]);
+            __m256 w2 = _mm256_set1_ps(data[k+2]);
+            __m256 w3 = _mm256_set1_ps(data[k+3]);
+            int n = 0;
+            for (; n + 8 <= N; n += 8) {
+                __m256 yv = _mm256_loadu_ps(y + n);
+                yv = _mm256_fmadd_ps(w0, _mm256_loadu_ps(x0 + n), yv);
+                yv = _mm256_fmadd_ps(w1, _mm256_loadu_ps(x1 + n), yv);
+                yv = _mm256_fmadd_ps(w2, _mm256_loadu_ps(x2 + n), yv);
+                yv = _mm256_fmadd_ps(w3, _mm256_loadu_ps(x3 + n), yv);
+                _mm256_storeu_ps(y + n, yv);
+            }
+            for (; n < N; n++)
+                y[n] += data[k] * x0[n] + data[k+1] * x1[n]
+                    + data[k+2] * x2[n] + data[k+3] * x3[n];
+        }
+        for (; k < indptr[o+1]; k++) {
+            const float* x = XT + (int64_t)indices[k] * N;
+            __m256 w = _mm256_set1_ps(data[k]);
+            int n = 0;
+            for (; n + 8 <= N; n += 8) {
+                __m256 yv = _mm256_loadu_ps(y + n);
+                _mm256_storeu_ps(y + n,
+                    _mm256_fmadd_ps(w, _mm256_loadu_ps(x + n), yv));
+            }
+            for (; n < N; n++)
+                y[n] += data[k] * x[n];
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void cpu_backprop_sparse_gemm_avx2(float* dXT, float* d_data,
+        const float* dYT, const float* XT, const float* data,
+        const int* indices, const int* indptr, int nO, int N) {
+    for (int o = 0; o < nO; o++) {
+        const float* dy = dYT + (int64_t)o * N;
+        for (int k = indptr[o]; k < indptr[o+1]; k++) {
+            const float* x = XT + (int64_t)indices[k] * N;
+            float* dx = dXT + (int64_t)indices[k] * N;
+            __m256 w = _mm256_set1_ps(data[k]);
+            __m256 acc = _mm256_setzero_ps();
+            int n = 0;
+            for (; n + 8 <= N; n += 8) {
+                __m256 dyv = _mm256_loadu_ps(dy + n);
+                acc = _mm256_fmadd_ps(_mm256_loadu_ps(x + n), dyv, acc);
+                _mm256_storeu_ps(dx + n,
+                    _mm256_fmadd_ps(w, dyv, _mm256_loadu_ps(dx + n)));
+            }
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc),
+                _mm256_extractf128_ps(acc, 1));
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+            float d = _mm_cvtss_f32(s);
+            for (; n < N; n++) {
+                d += x[n] * dy[n];
+                dx[n] += data[k] * dy[n];
+            }
+            d_data[k] = d;
+        }
+    }
+}
+#endif
+
+/* As for the int8 GEMM, the AVX2 versions are used if the CPU supports
+   them, which needs FMA as well. */
+static void cpu_sparse_gemm(float* YT, const float* XT, const float* data,
+        const int* indices, const int* indptr, int nO, int N) {
+#ifdef THINC_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        cpu_sparse_gemm_avx2(YT, XT, data, indices, indptr, nO, N);
+        return;
+    }
+#endif
+    cpu_sparse_gemm_generic(YT, XT, data, indices, indptr, nO, N);
+}
+
+static void cpu_backprop_sparse_gemm(float* dXT, float* d_data,
+        const float* dYT, const float* XT, const float* data,
+        const int* indices, const int* indptr, int nO, int N) {
+#ifdef THINC_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        cpu_backprop_sparse_gemm_avx2(dXT, d_data, dYT, XT, data, indices,
+            indptr, nO, N);
+        return;
+    }
+#endif
+    cpu_backprop_sparse_gemm_generic(dXT, d_data, dYT, XT, data, indices,
+        indptr, nO, N);
+}
+/* Conversions between float32 and bfloat16, i.e. the upper half of the
+   bits of a float32, rounding to the nearest even value. NaNs are kept
+   quiet instead of rounding up to infinity. */
+#include <string.h>
+
+static inline float thinc_bf16_to_float(uint16_t h) {
+    uint32_t bits = (uint32_t)h << 16;
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static void cpu_float_to_bf16(uint16_t* out, const float* X, int64_t n) {
+    for (int64_t i = 0; i < n; i++) {
+        uint32_t bits;
+        memcpy(&bits, X + i, sizeof(bits));
+        uint32_t rounded = (bits + ((bits >> 16) & 1) + 0x7FFF) >> 16;
+        if ((bits & 0x7FFFFFFF) > 0x7F800000)
+            rounded = (bits >> 16) | 0x40;
+        out[i] = (uint16_t)rounded;
+    }
+}
+
+static void cpu_bf16_to_float(float* out, const uint16_t* X, int64_t n) {
+    for (int64_t i = 0; i < n; i++)
+        out[i] = thinc_bf16_to_float(X[i]);
+}
+
+/* Compute X @ W.T with W stored as bfloat16, accumulating in float32. */
+static void cpu_gemm_bf16_generic(float* Y, const float* X, const uint16_t* W,
+        int N, int nO, int nI) {
+    for (int i = 0; i < N; i++) {
+        const float* x = X + (int64_t)i * nI;
+        for (int o = 0; o < nO; o++) {
+            const uint16_t* w = W + (int64_t)o * nI;
+            float sum = 0;
+            for (int j = 0; j < nI; j++)
+                sum += x[j] * thinc_bf16_to_float(w[j]);
+            Y[(int64_t)i * nO + o] = sum;
+        }
+    }
+}
+
+#ifdef THINC_HAVE_AVX2
+__attribute__((target("avx")))
+static inline float thinc_hsum256(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+}
+
+/* The rows of X are processed in blocks of four, with the block size
+   known at compile time, so each block of eight weights is converted to
+   float32 once per block and the accumulators stay in registers. */
+#define THINC_GEMM_HALF(NAME, TARGET, LOAD8, LOAD1) \
+    __attribute__((target(TARGET), always_inline)) \
+    static inline void NAME##_rows(float* Y, const float* X, \
+            const uint16_t* W, int n, int nO, int nI) { \
+        for (int o = 0; o < nO; o++) { \
+            const uint16_t* w = W + (int64_t)o * nI; \
+            __m256 acc[4], acc2[4]; \
+            for (int r = 0; r < n; r++) { \
+                acc[r] = _mm256_setzero_ps(); \
+                acc2[r] = _mm256_setzero_ps(); \
+            } \
+            int j = 0; \
+            for (; j + 16 <= nI; j += 16) { \
+                __m256 wv = LOAD8(w + j); \
+                __m256 wv2 = LOAD8(w + j + 8); \
+                for (int r = 0; r < n; r++) { \
+                    const float* x = X + (int64_t)r * nI + j; \
+                    acc[r] = _mm256_fmadd_ps(_mm256_loadu_ps(x), wv, acc[r]); \
+                    acc2[r] = _mm256_fmadd_ps(_mm256_loadu_ps(x + 8), wv2, acc2[r]); \
+                } \
+            } \
+            for (; j + 8 <= nI; j += 8) { \
+                __m256 wv = LOAD8(w + j); \
+                for (int r = 0; r < n; r++) \
+                    acc[r] = _mm256_fmadd_ps( \
+                        _mm256_loadu_ps(X + (int64_t)r * nI + j), wv, acc[r]); \
+            } \
+            for (int r = 0; r < n; r++) { \
+                const float* x = X + (int64_t)r * nI; \
+                float sum = thinc_hsum256(_mm256_add_ps(acc[r], acc2[r])); \
+                for (int k = j; k < nI; k++) \
+                    sum += x[k] * LOAD1(w[k]); \
+                Y[(int64_t)r * nO + o] = sum; \
+            } \
+        } \
+    } \
+    \
+    __attribute__((target(TARGET))) \
+    static void NAME(float* Y, const float* X, const uint16_t* W, \
+            int N, int nO, int nI) { \
+        int i = 0; \
+        for (; i + 4 <= N; i += 4) \
+            NAME##_rows(Y + (int64_t)i * nO, X + (int64_t)i * nI, W, 4, nO, nI); \
+        for (; i < N; i++) \
+            NAME##_rows(Y + (int64_t)i * nO, X + (int64_t)i * nI, W, 1, nO, nI); \
+    }
+
+#define THINC_LOAD8_BF16(p) _mm256_castsi256_ps(_mm256_slli_epi32( \
+    _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(p))), 16))
+#define THINC_LOAD8_F16(p) _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(p)))
+
+THINC_GEMM_HALF(cpu_gemm_bf16_avx2, "avx2,fma", THINC_LOAD8_BF16,
+    thinc_bf16_to_float)
+THINC_GEMM_HALF(cpu_gemm_f16_avx2, "avx2,fma,f16c", THINC_LOAD8_F16, _cvtsh_ss)
+#endif
+
+/* Compute X @ W.T with W stored as bfloat16 or float16. Returns 0 if
+   there's no kernel for float16 on this CPU, which needs F16C. */
+static int cpu_gemm_half(float* Y, const float* X, const uint16_t* W,
+        int is_bf16, int N, int nO, int nI) {
+#ifdef THINC_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        if (is_bf16) {
+            cpu_gemm_bf16_avx2(Y, X, W, N, nO, nI);
+            return 1;
+        }
+        else if (__builtin_cpu_supports("f16c")) {
+            cpu_gemm_f16_avx2(Y, X, W, N, nO, nI);
+            return 1;
+        }
+    }
+#endif
+    if (is_bf16) {
+        cpu_gemm_bf16_generic(Y, X, W, N, nO, nI);
+        return 1;
+    }
+    return 0;
+}
+
+#endif
@@ -15,6 +15,7 @@ except ImportError:
 from .ops import Ops
 from .numpy_ops import NumpyOps
 from . import _custom_kernels
+from . import _memory
 from ..util import get_array_module
 from ..types import DeviceTypes
 
@@ -48,7 +49,7 @@ class CupyOps(Ops):
         if out is None:
             return self.xp.dot(x, y)
         else:
-            self.xp.dot(x, y, out=out)
+            self.xp.matmul(x, y, out=out)
             return out
 
     def asarray(self, data, dtype=None):
@@ -56,7 +57,7 @@ class CupyOps(Ops):
         # forward "unset".
         dtype = {"dtype": dtype} if dtype is not None else {}
         if isinstance(data, cupy.ndarray):
-            return self.xp.asarray(data, **dtype)
+            array = self.xp.asarray(data, **dtype)
         elif hasattr(data, "data_ptr"):
             # Handles PyTorch Tensors
             pointer = cupy.cuda.MemoryPointer(data.data_ptr())
@@ -64,8 +65,10 @@ class CupyOps(Ops):
             array = self.xp.ndarray(shape, memptr=pointer, **dtype)
             return array
         else:
-            result = self.xp.array(data, **dtype)
-            return result
+            array = self.xp.array(data, **dtype)
+        if _memory.active_tracker is not None and array is not data:
+            _memory.active_tracker.track(array)
+        return array
 
     def maxout(self, X):
         return _custom_kernels.maxout(X)
@@ -99,14 +102,18 @@ class CupyOps(Ops):
             gradient *= threshold / grad_norm
         return gradient
 
-    def seq2col(self, seq, nW):
+    def seq2col(self, seq, nW, *, lengths=None):
         """Given an (M, N) sequence of vectors, return an (M, N*(nW*2+1)) sequence.
         The new sequence is constructed by concatenating nW preceding and succeeding
         vectors onto each column in the sequence, to extract a window of features.
         """
+        if lengths is not None:
+            return super().seq2col(seq, nW, lengths=lengths)
         return _custom_kernels.seq2col(seq, nW)
 
-    def backprop_seq2col(self, dY, nW):
+    def backprop_seq2col(self, dY, nW, *, lengths=None):
+        if lengths is not None:
+            return super().backprop_seq2col(dY, nW, lengths=lengths)
         return _custom_kernels.backprop_seq2col(dY, nW)
 
     def reduce_mean(self, X, lengths):
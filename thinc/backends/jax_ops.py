@@ -2,8 +2,8 @@ from typing import Sequence, Optional, List, Tuple, Callable, cast, TypeVar, Uni
 from typing import overload
 import numpy
 
-from .ops import Ops
-from ..types import Floats1d, Floats2d, Floats3d, Ints1d, Ints2d, Ints3d
+from .ops import Ops, _get_dropout_bits, _get_dropout_threshold
+from ..types import Floats1d, Floats2d, Floats3d, FloatsXd, Ints1d, Ints2d, Ints3d
 from ..types import ArrayXd, DTypes, Array3d, DeviceTypes, Padded, List2d, _Floats
 
 
@@ -45,23 +45,62 @@ class JaxOps(Ops):
         else:
             return jax.device_get(data)
 
-    def seq2col(self, seq: Floats2d, nW: int) -> Floats2d:
+    def seq2col(
+        self, seq: Floats2d, nW: int, *, lengths: Optional[Ints1d] = None
+    ) -> Floats2d:
         """Given an (M, N) sequence of vectors, return an (M, N*(nW*2+1))
         sequence. The new sequence is constructed by concatenating nW preceding
         and succeeding vectors onto each column in the sequence, to extract a
         window of features.
         """
+        if lengths is not None:  # pragma: no cover
+            raise ValueError("Currently seq2col with lengths isn't supported.")
         if nW == 1:
             return seq2col_one(seq)
         else:  # pragma: no cover
             raise ValueError("Currently only nW=1 supported.")
 
-    def backprop_seq2col(self, dY: Floats2d, nW: int) -> Floats2d:
+    def backprop_seq2col(
+        self, dY: Floats2d, nW: int, *, lengths: Optional[Ints1d] = None
+    ) -> Floats2d:
+        if lengths is not None:  # pragma: no cover
+            raise ValueError("Currently seq2col with lengths isn't supported.")
         if nW == 1:
             return backprop_seq2col_one(dY)
         else:  # pragma: no cover
             raise ValueError("Currently only nW=1 supported.")
 
+    def pack_window_weights(self, W: Floats2d, nW: int) -> Floats2d:  # type: ignore
+        # The windows are built below, so the weights are used as they are.
+        return W
+
+    def window_gemm(
+        self,
+        X: Floats2d,
+        W: Union[Floats2d, Floats3d],
+        nW: int,
+        *,
+        lengths: Optional[Ints1d] = None,
+    ) -> Floats2d:
+        # JAX arrays can't be updated in place, so this builds the windows.
+        # The weights are never packed, see pack_window_weights.
+        cols = self.seq2col(X, nW, lengths=lengths)
+        return self.gemm(cols, cast(Floats2d, W), trans2=True)
+
+    def backprop_window_gemm(
+        self,
+        dY: Floats2d,
+        X: Floats2d,
+        W: Union[Floats2d, Floats3d],
+        nW: int,
+        *,
+        lengths: Optional[Ints1d] = None,
+    ) -> Tuple[Floats2d, Floats2d]:
+        cols = self.seq2col(X, nW, lengths=lengths)
+        dX = self.gemm(dY, cast(Floats2d, W))
+        dX = self.backprop_seq2col(dX, nW, lengths=lengths)
+        return dX, self.gemm(dY, cols, trans1=True)
+
     def gemm(
         self,
         x: Floats2d,
@@ -79,6 +118,16 @@ class JaxOps(Ops):
     def affine(self, X: Floats2d, W: Floats2d, b: Floats1d) -> Floats2d:
         return affine(X, W, b)
 
+    def dropout(self, X: FloatsXd, rate: float, *, seed: int) -> FloatsXd:
+        if rate <= 0 or rate >= 1.0:
+            return super().dropout(X, rate, seed=seed)
+        # The mask generator needs 64-bit integers, which JAX truncates to 32
+        # bits unless x64 is enabled, so the mask is computed with numpy. This
+        # keeps the masks identical to the other backends.
+        bits = _get_dropout_bits(numpy, X.size, seed)
+        keep = self.asarray(bits.reshape(X.shape) >= _get_dropout_threshold(rate))
+        return X * keep * (1.0 / (1.0 - rate))
+
     def flatten(
         self,
         X: Sequence[ArrayT],
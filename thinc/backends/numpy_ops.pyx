@@ -6,9 +6,9 @@ import numpy
 cimport cython
 from libc.string cimport memcpy, memset
 from libc.stdlib cimport calloc, malloc, free
-from libc.stdint cimport uint32_t, uint64_t
+from libc.stdint cimport int8_t, int16_t, int64_t, uint16_t, uint32_t, uint64_t
 from libc.string cimport memcpy
-from libc.math cimport isnan
+from libc.math cimport isnan, sqrt
 from cymem.cymem cimport Pool
 from preshed.maps cimport PreshMap
 from murmurhash.mrmr cimport hash64, hash128_x86, hash128_x64
@@ -17,7 +17,9 @@ cimport numpy as np
 from ..util import copy_array, get_array_module
 from ..types import DeviceTypes, DTypes, Shape, ArrayXd
 from .linalg cimport VecVec, Vec
-from .ops import Ops
+from .ops import Ops, _get_dropout_threshold, _check_int8_shapes, _check_csr
+from .ops import _check_compressed_weights
+from . import _memory
 
 try:
     import blis.py
@@ -36,6 +38,22 @@ cdef extern from "math.h":
     float tanhf(float x) nogil
     float sinf(float x) nogil
     float cosf(float x) nogil
+    float fabsf(float x) nogil
+    float rintf(float x) nogil
+
+
+cdef extern from "cpu_kernels.h":
+    void cpu_gemm_int8(float* Y, const int16_t* X, const float* x_scales,
+        const int8_t* W, const float* w_scales, int N, int nO, int nI) nogil
+    void cpu_sparse_gemm(float* YT, const float* XT, const float* data,
+        const int* indices, const int* indptr, int nO, int N) nogil
+    void cpu_backprop_sparse_gemm(float* dXT, float* d_data, const float* dYT,
+        const float* XT, const float* data, const int* indices,
+        const int* indptr, int nO, int N) nogil
+    void cpu_float_to_bf16(uint16_t* out, const float* X, int64_t n) nogil
+    void cpu_bf16_to_float(float* out, const uint16_t* X, int64_t n) nogil
+    int cpu_gemm_half(float* Y, const float* X, const uint16_t* W, int is_bf16,
+        int N, int nO, int nI) nogil
 
 
 class NumpyOps(Ops):
@@ -58,31 +76,138 @@ class NumpyOps(Ops):
     def asarray(self, data, dtype=None):
         if isinstance(data, self.xp.ndarray):
             if dtype is not None:
-                return self.xp.asarray(data, dtype=dtype)
+                array = self.xp.asarray(data, dtype=dtype)
             else:
-                return self.xp.asarray(data)
+                array = self.xp.asarray(data)
         elif hasattr(data, 'numpy'):
             # Handles PyTorch Tensor
             return data.numpy()
         elif hasattr(data, "get"):
-            return data.get()
+            array = data.get()
         elif dtype is not None:
-            return self.xp.array(data, dtype=dtype)
+            array = self.xp.array(data, dtype=dtype)
         else:
-            return self.xp.array(data)
+            array = self.xp.array(data)
+        if _memory.active_tracker is not None and array is not data:
+            _memory.active_tracker.track(array)
+        return array
 
     def alloc(self, shape: Shape, *, dtype: Optional[DTypes] = "float32") -> ArrayXd:
-        return self.xp.zeros(shape, dtype=dtype)
+        array = self.xp.zeros(shape, dtype=dtype)
+        if _memory.active_tracker is not None:
+            _memory.active_tracker.track(array)
+        return array
 
     def gemm(self, np.ndarray x, np.ndarray y, *, np.ndarray out=None, trans1=False, trans2=False):
         if not self.use_blis:  # delegate to base Ops
             return super().gemm(x, y, out=out, trans1=trans1, trans2=trans2)
         x = self.as_contig(x)
         y = self.as_contig(y)
-        if out is not None:
-            out = self.as_contig(out)
+        if out is not None and not out.flags.c_contiguous:
+            # blis.py can't write into a strided output, such as a column
+            # block of a larger array, so accumulate a temporary into it.
+            out += blis.py.gemm(x, y, trans1=trans1, trans2=trans2)
+            return out
         return blis.py.gemm(x, y, out=out, trans1=trans1, trans2=trans2)
 
+    def gemm_int8(self, const float[:, ::1] X, const int8_t[:, ::1] W,
+            const float[::1] W_scale, *, X_scale=None):
+        _check_int8_shapes(X, W, W_scale)
+        if X_scale is not None and not X_scale > 0:
+            raise ValueError(f"Invalid input scale for int8 GEMM: {X_scale}")
+        cdef int N = X.shape[0]
+        cdef int nO = W.shape[0]
+        cdef int nI = X.shape[1]
+        cdef float fixed_scale = X_scale if X_scale is not None else 0.
+        cdef np.ndarray Y = self.alloc((N, nO), dtype="float32")
+        cdef np.ndarray X_int16 = self.alloc((N, nI), dtype="int16")
+        cdef np.ndarray x_scales = self.alloc((N,), dtype="float32")
+        if N != 0 and nO != 0 and nI != 0:
+            with nogil:
+                cpu_quantize_rows_int8(<int16_t*>X_int16.data,
+                    <float*>x_scales.data, &X[0, 0], fixed_scale, N, nI)
+                cpu_gemm_int8(<float*>Y.data, <int16_t*>X_int16.data,
+                    <float*>x_scales.data, &W[0, 0], &W_scale[0], N, nO, nI)
+        return Y
+
+    def compress_floats(self, X, storage):
+        if storage != "bfloat16":
+            return Ops.compress_floats(self, X, storage)
+        cdef np.ndarray X_f = self.xp.ascontiguousarray(X, dtype="float32")
+        cdef np.ndarray out = self.alloc(X.shape, dtype="uint16")
+        cdef int64_t size = X_f.size
+        with nogil:
+            cpu_float_to_bf16(<uint16_t*>out.data, <float*>X_f.data, size)
+        return out
+
+    def decompress_floats(self, X, storage):
+        if storage != "bfloat16":
+            return Ops.decompress_floats(self, X, storage)
+        cdef np.ndarray X_h = self.xp.ascontiguousarray(X, dtype="uint16")
+        cdef np.ndarray out = self.alloc(X.shape, dtype="float32")
+        cdef int64_t size = X_h.size
+        with nogil:
+            cpu_bf16_to_float(<float*>out.data, <uint16_t*>X_h.data, size)
+        return out
+
+    def gemm_compressed(self, X, W, storage):
+        _check_compressed_weights(X, W, storage)
+        # The kernel converts the weights once per block of four rows, so for
+        # larger batches it's faster to convert them once and call sgemm.
+        if storage == "float32" or X.shape[0] > 16:
+            return Ops.gemm_compressed(self, X, W, storage)
+        cdef np.ndarray X_f = self.xp.ascontiguousarray(X, dtype="float32")
+        cdef np.ndarray W_h = self.xp.ascontiguousarray(W).view("uint16")
+        cdef int N = X_f.shape[0]
+        cdef int nO = W_h.shape[0]
+        cdef int nI = W_h.shape[1]
+        cdef int is_bf16 = storage == "bfloat16"
+        cdef int ok = 1
+        cdef np.ndarray Y = self.alloc((N, nO), dtype="float32")
+        if N != 0 and nO != 0 and nI != 0:
+            with nogil:
+                ok = cpu_gemm_half(<float*>Y.data, <float*>X_f.data,
+                    <uint16_t*>W_h.data, is_bf16, N, nO, nI)
+        if not ok:
+            return Ops.gemm_compressed(self, X, W, storage)
+        return Y
+
+    def sparse_gemm(self, const float[:, ::1] X, const float[::1] data,
+            const int[::1] indices, const int[::1] indptr):
+        _check_csr(self, X, numpy.asarray(data), numpy.asarray(indices),
+            numpy.asarray(indptr))
+        cdef int N = X.shape[0]
+        cdef int nO = indptr.shape[0] - 1
+        # Work on the transposed inputs and outputs, so that each non-zero
+        # weight is applied to a contiguous row of the batch.
+        cdef np.ndarray XT = self.xp.ascontiguousarray(self.asarray(X).T)
+        cdef np.ndarray YT = self.alloc((nO, N), dtype="float32")
+        if N != 0 and data.shape[0] != 0:
+            with nogil:
+                cpu_sparse_gemm(<float*>YT.data, <float*>XT.data, &data[0],
+                    &indices[0], &indptr[0], nO, N)
+        return self.xp.ascontiguousarray(YT.T)
+
+    def backprop_sparse_gemm(self, const float[:, ::1] dY, const float[:, ::1] X,
+            const float[::1] data, const int[::1] indices, const int[::1] indptr):
+        _check_csr(self, X, numpy.asarray(data), numpy.asarray(indices),
+            numpy.asarray(indptr))
+        cdef int N = X.shape[0]
+        cdef int nI = X.shape[1]
+        cdef int nO = indptr.shape[0] - 1
+        if dY.shape[0] != N or dY.shape[1] != nO:
+            raise ValueError(f"Mismatched gradient shape for sparse_gemm: {(dY.shape[0], dY.shape[1])}")
+        cdef np.ndarray XT = self.xp.ascontiguousarray(self.asarray(X).T)
+        cdef np.ndarray dYT = self.xp.ascontiguousarray(self.asarray(dY).T)
+        cdef np.ndarray dXT = self.alloc((nI, N), dtype="float32")
+        cdef np.ndarray d_data = self.alloc((data.shape[0],), dtype="float32")
+        if N != 0 and data.shape[0] != 0:
+            with nogil:
+                cpu_backprop_sparse_gemm(<float*>dXT.data, <float*>d_data.data,
+                    <float*>dYT.data, <float*>XT.data, &data[0], &indices[0],
+                    &indptr[0], nO, N)
+        return self.xp.ascontiguousarray(dXT.T), d_data
+
     def relu(self, np.ndarray X, inplace=False):
         cdef np.ndarray out = X if inplace else X.copy()
         cdef weight_t* data = <weight_t*>out.data
@@ -142,24 +267,97 @@ class NumpyOps(Ops):
         else:
             return dX
 
-    def seq2col(self, const float[:, ::1] seq, int nW):
+    def dropout(self, np.ndarray X, float rate, *, seed):
+        if X.dtype != numpy.float32 or not 0 < rate < 1:
+            return super().dropout(X, rate, seed=seed)
+        X = self.as_contig(X)
+        shape = [X.shape[i] for i in range(X.ndim)]
+        cdef np.ndarray Y = self.alloc(tuple(shape), dtype="float32")
+        cdef size_t size = X.size
+        cdef uint64_t seed_ = seed & 0xFFFFFFFFFFFFFFFF
+        cdef uint64_t threshold = _get_dropout_threshold(rate)
+        cdef float scale = 1. / (1. - rate)
+        with nogil:
+            cpu_dropout(<float*>Y.data, <const float*>X.data, size, seed_,
+                threshold, scale)
+        return Y
+
+    def backprop_dropout(self, np.ndarray dY, float rate, *, seed):
+        return self.dropout(dY, rate, seed=seed)
+
+    def layer_norm(self, const float[:, ::1] X, const float[::1] G,
+            const float[::1] b, *, float eps=1e-8):
+        cdef int N = X.shape[0]
+        cdef int I = X.shape[1]
+        cdef np.ndarray Y = self.alloc((N, I), dtype="float32")
+        cdef np.ndarray mean = self.alloc((N,), dtype="float32")
+        cdef np.ndarray inv_std = self.alloc((N,), dtype="float32")
+        if N != 0 and I != 0:
+            with nogil:
+                cpu_layer_norm(<float*>Y.data, <float*>mean.data,
+                    <float*>inv_std.data, &X[0, 0], &G[0], &b[0], eps, N, I)
+        return Y, mean, inv_std
+
+    def backprop_layer_norm(self, const float[:, ::1] dY,
+            const float[:, ::1] X, const float[::1] G,
+            const float[::1] mean, const float[::1] inv_std):
+        cdef int N = X.shape[0]
+        cdef int I = X.shape[1]
+        cdef np.ndarray dX = self.alloc((N, I), dtype="float32")
+        cdef np.ndarray dG = self.alloc((I,), dtype="float32")
+        cdef np.ndarray db = self.alloc((I,), dtype="float32")
+        if N != 0 and I != 0:
+            with nogil:
+                cpu_backprop_layer_norm(<float*>dX.data, <float*>dG.data,
+                    <float*>db.data, &dY[0, 0], &X[0, 0], &G[0], &mean[0],
+                    &inv_std[0], N, I)
+        return dX, dG, db
+
+    def seq2col(self, const float[:, ::1] seq, int nW, *, lengths=None):
         """Given an (M, N) sequence of vectors, return an (M, N*(nW*2+1))
         sequence. The new sequence is constructed by concatenating nW preceding
         and succeeding vectors onto each column in the sequence, to extract a
          window of features.
+
+        If `lengths` is given, the rows are a batch of concatenated sequences
+        with those lengths, and windows are zero-filled at the sequence
+        boundaries instead of reaching into the neighbouring sequences.
         """
         cdef int B = seq.shape[0]
         cdef int I = seq.shape[1]
-        cdef np.ndarray cols = self.alloc((B, (2*nW + 1) * I), dtype="float32")
-        seq2col(<float*>cols.data, &seq[0,0], nW, B, I)
+        cdef int nF = nW*2+1
+        cdef np.ndarray cols = self.alloc((B, nF * I), dtype="float32")
+        cdef int[::1] lengths_ = _check_lengths(self, lengths, B, "seq2col")
+        cdef float* output = <float*>cols.data
+        cdef int i, length
+        cdef int start = 0
+        if B == 0:
+            return cols
+        # Each sequence is windowed on its own, so nothing leaks across the
+        # boundaries.
+        for i in range(lengths_.shape[0]):
+            length = lengths_[i]
+            if length > 0:
+                seq2col(&output[start*nF*I], &seq[start, 0], nW, length, I)
+            start += length
         return cols
 
-    def backprop_seq2col(self, const float[:, ::1] dY, int nW):
+    def backprop_seq2col(self, const float[:, ::1] dY, int nW, *, lengths=None):
         cdef int B = dY.shape[0]
         cdef int nF = nW*2+1
         cdef int I = dY.shape[1] / nF
         cdef np.ndarray dX = self.alloc((B, I), dtype='float32')
-        backprop_seq2col(<float*>dX.data, &dY[0,0], B, I, nW)
+        cdef int[::1] lengths_ = _check_lengths(self, lengths, B, "seq2col")
+        cdef float* d_seqs = <float*>dX.data
+        cdef int i, length
+        cdef int start = 0
+        if B == 0:
+            return dX
+        for i in range(lengths_.shape[0]):
+            length = lengths_[i]
+            if length > 0:
+                backprop_seq2col(&d_seqs[start*I], &dY[start, 0], length, I, nW)
+            start += length
         return dX
 
     @cython.boundscheck(False)
@@ -264,6 +462,76 @@ class NumpyOps(Ops):
 
         return cpu_floats_ptr2array(dX, (T, O))
 
+    def softmax_cross_entropy(self, const float[:, ::1] logits, targets):
+        cdef int N = logits.shape[0]
+        cdef int nC = logits.shape[1]
+        cdef np.ndarray targets_ = _check_targets(self, targets, N, nC)
+        cdef np.ndarray d_logits = self.alloc((N, nC), dtype="float32")
+        cdef np.ndarray losses = self.alloc((N,), dtype="float32")
+        if N != 0 and nC != 0:
+            cpu_softmax_cross_entropy(<float*>d_logits.data,
+                <float*>losses.data, &logits[0, 0], <int*>targets_.data, N, nC)
+        return d_logits, losses
+
+    def softmax_sequences(self, const float[:, ::1] Xs, lengths, *,
+            inplace=False, axis=-1):
+        cdef int T = Xs.shape[0]
+        cdef int O = Xs.shape[1]
+        cdef int[::1] lengths_ = _check_lengths(self, lengths, T, "softmax_sequences")
+        cdef np.ndarray Y = self.alloc((T, O), dtype="float32")
+        cdef Pool mem = Pool()
+        cdef float* sums = <float*>mem.alloc(O, sizeof(float))
+        if T != 0 and O != 0:
+            with nogil:
+                cpu_softmax_sequences(<float*>Y.data, sums,
+                    &Xs[0, 0], &lengths_[0], lengths_.shape[0], O)
+        return Y
+
+    def backprop_softmax_sequences(self, const float[:, ::1] dY,
+            const float[:, ::1] Y, lengths):
+        cdef int T = Y.shape[0]
+        cdef int O = Y.shape[1]
+        cdef int[::1] lengths_ = _check_lengths(self, lengths, T, "softmax_sequences")
+        cdef np.ndarray dX = self.alloc((T, O), dtype="float32")
+        cdef Pool mem = Pool()
+        cdef float* sums = <float*>mem.alloc(O, sizeof(float))
+        if T != 0 and O != 0:
+            with nogil:
+                cpu_backprop_softmax_sequences(<float*>dX.data, sums,
+                    &dY[0, 0], &Y[0, 0], &lengths_[0], lengths_.shape[0], O)
+        return dX
+
+    def parametric_attention(self, const float[:, ::1] X, const float[::1] Q,
+            lengths):
+        cdef int T = X.shape[0]
+        cdef int O = X.shape[1]
+        cdef int[::1] lengths_ = _check_lengths(self, lengths, T, "attention")
+        cdef np.ndarray Y = self.alloc((T, O), dtype="float32")
+        cdef np.ndarray attention = self.alloc((T, 1), dtype="float32")
+        if T != 0 and O != 0:
+            with nogil:
+                cpu_parametric_attention(<float*>Y.data,
+                    <float*>attention.data, &X[0, 0], &Q[0], &lengths_[0],
+                    lengths_.shape[0], O)
+        return Y, attention
+
+    def backprop_parametric_attention(self, const float[:, ::1] dY,
+            const float[:, ::1] X, const float[::1] Q,
+            const float[:, ::1] attention, lengths):
+        cdef int T = X.shape[0]
+        cdef int O = X.shape[1]
+        cdef int[::1] lengths_ = _check_lengths(self, lengths, T, "attention")
+        cdef np.ndarray dX = self.alloc((T, O), dtype="float32")
+        cdef np.ndarray dQ = self.alloc((O,), dtype="float32")
+        cdef Pool mem = Pool()
+        cdef float* d_scores = <float*>mem.alloc(T, sizeof(float))
+        if T != 0 and O != 0:
+            with nogil:
+                cpu_backprop_parametric_attention(<float*>dX.data,
+                    <float*>dQ.data, d_scores, &dY[0, 0], &X[0, 0], &Q[0],
+                    &attention[0, 0], &lengths_[0], lengths_.shape[0], O)
+        return dX, dQ
+
     def scatter_add(self, np.ndarray table, np.ndarray indices, np.ndarray values):
         if table.dtype == 'float32' \
         and indices.dtype == 'int32' \
@@ -303,6 +571,36 @@ class NumpyOps(Ops):
             output[i] = hash64(&keys_[i], n*sizeof(keys_[0]), 0)
         return output_
 
+    def unique_keys(self, keys):
+        """Find the unique values of a sequence of 64-bit keys in a single pass,
+        using a hash table. The unique keys are ordered by first occurrence.
+        """
+        cdef const uint64_t[::1] keys_ = numpy.ascontiguousarray(keys, dtype="uint64")
+        cdef int N = keys_.shape[0]
+        cdef np.ndarray ind = self.alloc((N,), dtype="int32")
+        cdef np.ndarray inv = self.alloc((N,), dtype="int32")
+        cdef np.ndarray counts = self.alloc((N,), dtype="int32")
+        cdef int* ind_ = <int*>ind.data
+        cdef int* inv_ = <int*>inv.data
+        cdef int* counts_ = <int*>counts.data
+        # Map each key to its unique index plus one, as missing keys map to 0.
+        cdef PreshMap table = PreshMap(initial_size=max(8, N * 2))
+        cdef size_t value
+        cdef int i
+        cdef int n_uniq = 0
+        for i in range(N):
+            value = <size_t>table.get(keys_[i])
+            if value == 0:
+                table.set(keys_[i], <void*>(<size_t>n_uniq + 1))
+                ind_[n_uniq] = i
+                inv_[i] = n_uniq
+                counts_[n_uniq] = 1
+                n_uniq += 1
+            else:
+                inv_[i] = value - 1
+                counts_[value - 1] += 1
+        return ind[:n_uniq], inv, counts[:n_uniq]
+
     def position_encode(self, int N, int D, int period=10000, out=None):
         cdef np.ndarray out_
         if out is None:
@@ -315,6 +613,26 @@ class NumpyOps(Ops):
         return out_
 
 
+def _check_lengths(ops, lengths, int B, str op):
+    if lengths is None:
+        return numpy.asarray([B], dtype="int32")
+    lengths = ops.as_contig(ops.asarray(lengths), dtype="int32")
+    if lengths.sum() != B:
+        raise ValueError(f"{op} lengths sum to {lengths.sum()}, not {B}")
+    if (lengths < 0).any():
+        raise ValueError(f"{op} lengths must not be negative")
+    return lengths
+
+
+def _check_targets(ops, targets, int N, int nC):
+    targets = ops.as_contig(ops.asarray(targets), dtype="int32")
+    if targets.shape != (N,):
+        raise ValueError(f"Expected {N} targets, got shape {targets.shape}")
+    if N != 0 and (targets.min() < 0 or targets.max() >= nC):
+        raise ValueError(f"Targets must be class indices between 0 and {nC - 1}")
+    return targets
+
+
 cdef void seq2col(float* output, const float* X, int nW, int B, int I) nogil:
     '''
     Let's say nW is 1 (it usually is). Then we want to take:
@@ -381,7 +699,7 @@ cdef void backprop_seq2col(float* d_seqs,
             col_feat -= I
             if col_row >= 0 and (col_row < (B*I*nF)):
                 j = col_row + col_feat
-                if j >= 0 and (j+I) < (B*I*nF):
+                if j >= 0 and (j+I) <= (B*I*nF):
                     VecVec.add_i(&d_seqs[seq_row],
                         &d_cols[j], 1., I)
 
@@ -523,6 +841,215 @@ cdef void cpu_backprop_mish(weight_t* dX,
             dX[i] = dY[i] * ((exp_x * omega) / (delta * delta))
 
 
+cdef void cpu_dropout(float* Y, const float* X, size_t N, uint64_t seed,
+        uint64_t threshold, float scale) nogil:
+    # The SplitMix64 finalizer of seed + (i + 1) * gamma. This must match
+    # _get_dropout_bits in ops.py. It's written out inline, since a function
+    # call per element would need an exception check.
+    cdef uint64_t z
+    cdef size_t i
+    for i in range(N):
+        z = seed + (i + 1) * 0x9E3779B97F4A7C15ULL
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL
+        z = z ^ (z >> 31)
+        # Branchless, since the branch would be unpredictable.
+        Y[i] = X[i] * (scale * ((z >> 40) >= threshold))
+
+
+cdef void cpu_layer_norm(float* Y, float* mean, float* inv_std,
+        const float* X, const float* G, const float* b, float eps,
+        int N, int I) nogil:
+    # One pass per row to get the moments and one to normalize, scale and
+    # shift. The moments are accumulated in double precision around the
+    # row's first value, which avoids the cancellation of the naive
+    # sum-of-squares formula without Welford's division per element.
+    cdef double shift, diff, total, total_sq, mu, rstd
+    for i in range(N):
+        shift = X[0]
+        total = 0.
+        total_sq = 0.
+        for j in range(I):
+            diff = X[j] - shift
+            total += diff
+            total_sq += diff * diff
+        mu = total / I
+        rstd = 1. / sqrt(max(total_sq / I - mu * mu, 0.) + eps)
+        mu += shift
+        mean[i] = mu
+        inv_std[i] = rstd
+        for j in range(I):
+            Y[j] = (X[j] - mu) * rstd * G[j] + b[j]
+        X += I
+        Y += I
+
+
+cdef void cpu_backprop_layer_norm(float* dX, float* dG, float* db,
+        const float* dY, const float* X, const float* G,
+        const float* mean, const float* inv_std, int N, int I) nogil:
+    # The first pass over each row accumulates the gradients of G and b along
+    # with the row sums that the second pass needs to compute dX.
+    cdef double sum_g, sum_g_xhat, xhat
+    for i in range(N):
+        sum_g = 0.
+        sum_g_xhat = 0.
+        for j in range(I):
+            xhat = (X[j] - mean[i]) * inv_std[i]
+            dG[j] += dY[j] * xhat
+            db[j] += dY[j]
+            sum_g += dY[j] * G[j]
+            sum_g_xhat += dY[j] * G[j] * xhat
+        sum_g /= I
+        sum_g_xhat /= I
+        for j in range(I):
+            xhat = (X[j] - mean[i]) * inv_std[i]
+            dX[j] = (dY[j] * G[j] - sum_g - xhat * sum_g_xhat) * inv_std[i]
+        X += I
+        dY += I
+        dX += I
+
+
+cdef void cpu_quantize_rows_int8(int16_t* X_int8, float* scales,
+        const float* X, float fixed_scale, int N, int nI) nogil:
+    # Symmetric quantization, with the scale of each row taken from its
+    # largest absolute value unless a fixed scale is given. The values are
+    # stored as int16, which is what the GEMM kernel multiplies with.
+    cdef float scale, inv_scale, value
+    for i in range(N):
+        scale = fixed_scale
+        if scale == 0.:
+            for j in range(nI):
+                scale = max(scale, fabsf(X[j]))
+            scale = scale / 127.
+            if scale == 0.:
+                scale = 1.
+        inv_scale = 1. / scale
+        for j in range(nI):
+            value = rintf(X[j] * inv_scale)
+            X_int8[j] = <int16_t>min(max(value, -127.), 127.)
+        scales[i] = scale
+        X += nI
+        X_int8 += nI
+
+
+cdef void cpu_softmax_cross_entropy(float* d_logits, float* losses,
+        const float* logits, const int* targets, int N, int nC) nogil:
+    # Write the softmax into the gradient buffer, take the loss from the
+    # log of the normalizer, then subtract the one-hot target in place.
+    cdef float max_, total
+    for i in range(N):
+        max_ = Vec.max(logits, nC)
+        total = 0.
+        for j in range(nC):
+            d_logits[j] = expf(logits[j] - max_)
+            total += d_logits[j]
+        Vec.mul_i(d_logits, 1. / total, nC)
+        losses[i] = logf(total) + max_ - logits[targets[i]]
+        d_logits[targets[i]] -= 1.
+        logits += nC
+        d_logits += nC
+
+
+cdef void cpu_softmax_sequences(float* Y__to, float* sums__o,
+        const float* X__to, const int* lengths__b, int B, int O) nogil:
+    # Softmax over the rows of each sequence, separately for each column.
+    # Like the generic implementation, the inputs are clipped to [-20, 20].
+    cdef float x
+    for length in lengths__b[:B]:
+        memset(sums__o, 0, O * sizeof(float))
+        for t in range(length):
+            for o in range(O):
+                x = min(max(X__to[t*O+o], -20.), 20.)
+                Y__to[t*O+o] = expf(x)
+                sums__o[o] += Y__to[t*O+o]
+        for o in range(O):
+            sums__o[o] = 1. / sums__o[o]
+        for t in range(length):
+            for o in range(O):
+                Y__to[t*O+o] *= sums__o[o]
+        X__to += length * O
+        Y__to += length * O
+
+
+cdef void cpu_backprop_softmax_sequences(float* dX__to, float* sums__o,
+        const float* dY__to, const float* Y__to, const int* lengths__b,
+        int B, int O) nogil:
+    for length in lengths__b[:B]:
+        memset(sums__o, 0, O * sizeof(float))
+        for t in range(length):
+            for o in range(O):
+                dX__to[t*O+o] = Y__to[t*O+o] * dY__to[t*O+o]
+                sums__o[o] += dX__to[t*O+o]
+        for t in range(length):
+            for o in range(O):
+                dX__to[t*O+o] -= Y__to[t*O+o] * sums__o[o]
+        dX__to += length * O
+        dY__to += length * O
+        Y__to += length * O
+
+
+cdef inline float _dot(const float* x, const float* y, int n) nogil:
+    # Independent partial sums, so the adds don't wait on each other.
+    cdef float s0 = 0., s1 = 0., s2 = 0., s3 = 0.
+    cdef int i = 0
+    while i + 4 <= n:
+        s0 += x[i] * y[i]
+        s1 += x[i+1] * y[i+1]
+        s2 += x[i+2] * y[i+2]
+        s3 += x[i+3] * y[i+3]
+        i += 4
+    while i < n:
+        s0 += x[i] * y[i]
+        i += 1
+    return (s0 + s1) + (s2 + s3)
+
+
+cdef void cpu_parametric_attention(float* Y__to, float* attn__t,
+        const float* X__to, const float* Q__o, const int* lengths__b,
+        int B, int O) nogil:
+    # Score each row against Q, take the softmax of the scores within each
+    # sequence, and weight the rows by it.
+    cdef float total, score
+    for length in lengths__b[:B]:
+        total = 0.
+        for t in range(length):
+            score = _dot(&X__to[t*O], Q__o, O)
+            attn__t[t] = expf(min(max(score, -20.), 20.))
+            total += attn__t[t]
+        for t in range(length):
+            attn__t[t] /= total
+            for o in range(O):
+                Y__to[t*O+o] = X__to[t*O+o] * attn__t[t]
+        X__to += length * O
+        Y__to += length * O
+        attn__t += length
+
+
+cdef void cpu_backprop_parametric_attention(float* dX__to, float* dQ__o,
+        float* d_scores__t, const float* dY__to, const float* X__to,
+        const float* Q__o, const float* attn__t, const int* lengths__b,
+        int B, int O) nogil:
+    cdef float d_attn, total
+    for length in lengths__b[:B]:
+        # Gradient of the weights, then of the scores through the softmax.
+        total = 0.
+        for t in range(length):
+            d_attn = _dot(&X__to[t*O], &dY__to[t*O], O)
+            d_scores__t[t] = attn__t[t] * d_attn
+            total += d_scores__t[t]
+        for t in range(length):
+            d_scores__t[t] -= attn__t[t] * total
+            for o in range(O):
+                dX__to[t*O+o] = (dY__to[t*O+o] * attn__t[t]
+                                 + d_scores__t[t] * Q__o[o])
+                dQ__o[o] += d_scores__t[t] * X__to[t*O+o]
+        dX__to += length * O
+        dY__to += length * O
+        X__to += length * O
+        attn__t += length
+        d_scores__t += length
+
+
 cdef cpu_floats_ptr2array(float* ptr, shape):
     cdef np.ndarray py_out = numpy.zeros(shape, dtype='float32')
     cdef int N = numpy.prod(shape)
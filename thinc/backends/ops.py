@@ -7,7 +7,9 @@ from ..types import Xp, Shape, DTypes, DTypesInt, DTypesFloat, List2d, ArrayXd
 from ..types import Array2d, Array3d, Floats1d, Floats2d, Floats3d, Floats4d
 from ..types import FloatsXd, Ints1d, Ints2d, Ints3d, Ints4d, IntsXd, _Floats
 from ..types import DeviceTypes, Generator, Padded, Batchable, SizedGenerator
+from ..types import FloatStorage
 from ..util import get_array_module, is_xp_array
+from . import _memory
 
 
 ArrayT = TypeVar("ArrayT", bound=ArrayXd)
@@ -140,41 +142,145 @@ class Ops:
             i += output[-1]
         return output
 
-    def seq2col(self, seq: Floats2d, nW: int) -> Floats2d:
+    def seq2col(
+        self, seq: Floats2d, nW: int, *, lengths: Optional[Ints1d] = None
+    ) -> Floats2d:
         """Given an (M, N) sequence of vectors, return an (M, N*(nW*2+1))
         sequence. The new sequence is constructed by concatenating nW preceding
         and succeeding vectors onto each column in the sequence, to extract a
         window of features.
+
+        If `lengths` is given, the rows are a batch of concatenated sequences
+        with those lengths, and windows are zero-filled at the sequence
+        boundaries instead of reaching into the neighbouring sequences.
         """
-        # This is a test implementation that only supports nW=1
-        assert nW == 1
         B = seq.shape[0]
+        nF = nW * 2 + 1
         I = seq.shape[1]
-        cols = self.alloc3f(B, (nW * 2 + 1), I)
-        # Copy left contexts. The last words aren't the left-context for anything.
-        cols[nW:, :nW] = self.reshape3f(seq[:-nW], -1, nW, I)
-        cols[:, nW] = seq
-        cols[:-nW, nW + 1 :] = self.reshape3f(seq[nW:], -1, nW, I)
-        return self.reshape2f(cols, B, I * (2 * nW + 1))
-
-    def backprop_seq2col(self, dY: Floats2d, nW: int) -> Floats2d:
+        cols = self.alloc3f(B, nF, I)
+        rows, row_starts, row_ends = _get_seq2col_bounds(self, B, lengths)
+        for f in range(-nW, nW + 1):
+            src = rows + f
+            valid = (src >= row_starts) & (src < row_ends)
+            cols[valid, f + nW] = seq[src[valid]]
+        return self.reshape2f(cols, B, I * nF)
+
+    def backprop_seq2col(
+        self, dY: Floats2d, nW: int, *, lengths: Optional[Ints1d] = None
+    ) -> Floats2d:
         """The reverse/backward operation of the `seq2col` function: calculate
         the gradient of the original `(M, N)` sequence, as a function of the
         gradient of the output `(M, N*(nW*2+1))` sequence.
         """
-        # This is a test implementation that only supports nW=1
-        assert nW == 1
         nF = nW * 2 + 1
         B = dY.shape[0]
         I = dY.shape[1] // nF
-        # Having trouble getting the kernel to work...
         dX = self.alloc2f(B, I)
         dY3d = self.reshape3f(dY, B, nF, I)
-        dX[:-nW] += self.reshape2f(dY3d[nW:, :nW], -1, I)
-        dX += dY3d[:, nW]
-        dX[nW:] += self.reshape2f(dY3d[:-nW, nW + 1 :], -1, I)
+        rows, row_starts, row_ends = _get_seq2col_bounds(self, B, lengths)
+        for f in range(-nW, nW + 1):
+            src = rows + f
+            valid = (src >= row_starts) & (src < row_ends)
+            # Each row is the source of at most one window position per
+            # offset, so there are no duplicate indices here.
+            dX[src[valid]] += dY3d[valid, f + nW]
         return dX
 
+    def pack_window_weights(self, W: Floats2d, nW: int) -> Floats3d:
+        """Reorder the (nO, (nW*2+1)*N) weights of `window_gemm` into the
+        contiguous ((nW*2+1), nO, N) layout it computes with, so that each
+        window position has its own matrix. `window_gemm` and
+        `backprop_window_gemm` accept the packed weights in place of W, which
+        saves reordering them at every call while they don't change.
+        """
+        nF = nW * 2 + 1
+        W3 = self.reshape3f(W, W.shape[0], nF, W.shape[1] // nF)
+        return self.xp.ascontiguousarray(W3.transpose((1, 0, 2)))
+
+    def window_gemm(
+        self,
+        X: Floats2d,
+        W: Union[Floats2d, Floats3d],
+        nW: int,
+        *,
+        lengths: Optional[Ints1d] = None,
+    ) -> Floats2d:
+        """Compute `seq2col(X, nW, lengths=lengths) @ W.T` without building the
+        (M, N*(nW*2+1)) window matrix. W has the shape (nO, (nW*2+1)*N), like
+        the weights of a layer applied after seq2col. The product is
+        accumulated from one GEMM per window position over shifted row blocks
+        of X, so the only temporary is a single (M, nO) buffer. W can also be
+        given in the layout of `pack_window_weights`.
+        """
+        B, I = X.shape
+        W3 = _get_window_weights(self, W, nW)
+        nO = W3.shape[1]
+        Y = self.alloc2f(B, nO)
+        self.gemm(X, W3[nW], out=Y, trans2=True)
+        if nW == 0 or B == 0:
+            return Y
+        bounds = _get_seq2col_bounds(self, B, lengths) if lengths is not None else None
+        tmp = self.alloc2f(B, nO)
+        for d in range(-nW, nW + 1):
+            n = B - abs(d)
+            if d == 0 or n <= 0:
+                continue
+            lo = max(0, -d)
+            out = tmp[:n]
+            # Some backends accumulate into out, so clear it first.
+            out.fill(0)
+            self.gemm(X[lo + d : lo + d + n], W3[d + nW], out=out, trans2=True)
+            if bounds is not None:
+                out[_get_window_dropped(self, bounds, lo, n, d)] = 0
+            Y[lo : lo + n] += out
+        return Y
+
+    def backprop_window_gemm(
+        self,
+        dY: Floats2d,
+        X: Floats2d,
+        W: Union[Floats2d, Floats3d],
+        nW: int,
+        *,
+        lengths: Optional[Ints1d] = None,
+    ) -> Tuple[Floats2d, Floats2d]:
+        """The backward pass of `window_gemm`: given the gradient of the
+        output, return the gradients of X and of W. Like the forward pass, this
+        never builds the window matrix or its gradient.
+        """
+        B, I = X.shape
+        nF = nW * 2 + 1
+        W3 = _get_window_weights(self, W, nW)
+        nO = W3.shape[1]
+        dX = self.alloc2f(B, I)
+        dW3 = self.alloc3f(nF, nO, I)
+        self.gemm(dY, W3[nW], out=dX)
+        self.gemm(dY, X, out=dW3[nW], trans1=True)
+        bounds = _get_seq2col_bounds(self, B, lengths) if lengths is not None else None
+        tmp = self.alloc2f(B, I)
+        for d in range(-nW, nW + 1):
+            n = B - abs(d)
+            if d == 0 or n <= 0:
+                continue
+            lo = max(0, -d)
+            dY_block = dY[lo : lo + n]
+            X_block = X[lo + d : lo + d + n]
+            out = tmp[:n]
+            out.fill(0)
+            self.gemm(dY_block, W3[d + nW], out=out)
+            self.gemm(dY_block, X_block, out=dW3[d + nW], trans1=True)
+            if bounds is not None:
+                dropped = _get_window_dropped(self, bounds, lo, n, d)
+                out[dropped] = 0
+                # Only a few rows per sequence boundary are dropped, so it's
+                # cheaper to subtract their products than to mask the blocks.
+                dW3[d + nW] -= self.gemm(
+                    dY_block[dropped], X_block[dropped], trans1=True
+                )
+            dX[lo + d : lo + d + n] += out
+        dW = self.xp.ascontiguousarray(dW3.transpose((1, 0, 2)))
+        return dX, self.reshape2f(dW, nO, nF * I)
+
     def gemm(
         self,
         x: Floats2d,
@@ -193,7 +299,9 @@ class Ops:
         if out is None:
             return self.xp.dot(x, y)
         else:
-            self.xp.dot(x, y, out=out)
+            # Unlike dot, matmul can write into a strided output, such as a
+            # column block of a larger array.
+            self.xp.matmul(x, y, out=out)
             return out
 
     def affine(self, X: Floats2d, W: Floats2d, b: Floats1d) -> Floats2d:
@@ -204,6 +312,111 @@ class Ops:
         Y += b
         return Y
 
+    def quantize_int8(self, W: Floats2d) -> Tuple[Ints2d, Floats1d]:
+        """Quantize the rows of a weights matrix to int8, with one scale per row,
+        i.e. per output channel, so that W ~= W_int8 * scale[:, None].
+        """
+        scale = self.xp.abs(W).max(axis=1) / self.xp.float32(127.0)
+        scale = self.xp.where(scale == 0, self.xp.float32(1.0), scale)
+        W_int8 = self.xp.rint(W * (1 / scale)[:, None]).clip(-127, 127)
+        return W_int8.astype("int8"), scale.astype("float32")
+
+    def gemm_int8(
+        self,
+        X: Floats2d,
+        W: Ints2d,
+        W_scale: Floats1d,
+        *,
+        X_scale: Optional[float] = None,
+    ) -> Floats2d:
+        """Compute X @ W.T for weights quantized by `quantize_int8`. Each row of
+        X is quantized to int8 with its own scale, unless a fixed `X_scale` is
+        given, e.g. from calibration, in which case larger values are clipped.
+        The products are accumulated in int32.
+        """
+        _check_int8_shapes(X, W, W_scale)
+        x_scales = _get_int8_input_scales(self, X, X_scale)
+        X_int8 = self.xp.rint(X * (1 / x_scales)[:, None]).clip(-127, 127)
+        acc = self.xp.dot(X_int8.astype("int32"), W.astype("int32").T)
+        return acc.astype("float32") * x_scales[:, None] * W_scale
+
+    def compress_floats(self, X: FloatsXd, storage: FloatStorage) -> ArrayXd:
+        """Convert float32 values to a reduced-precision storage type, rounding
+        to the nearest value. bfloat16 values are stored in a uint16 array, as
+        the upper half of the bits of the float32 values.
+        """
+        _check_storage(storage)
+        if storage == "float32":
+            return self.asarray(X, dtype="float32")
+        elif storage == "float16":
+            return X.astype("float16")
+        bits = self.xp.ascontiguousarray(X, dtype="float32").view("uint32")
+        # Round to nearest even, keeping NaNs from rounding up to infinity.
+        rounded = (bits + ((bits >> 16) & 1) + 0x7FFF) >> 16
+        is_nan = (bits & 0x7FFFFFFF) > 0x7F800000
+        rounded = self.xp.where(is_nan, (bits >> 16) | 0x40, rounded)
+        return rounded.astype("uint16")
+
+    def decompress_floats(self, X: ArrayXd, storage: FloatStorage) -> FloatsXd:
+        """Convert values stored by `compress_floats` back to float32."""
+        _check_storage(storage)
+        if storage != "bfloat16":
+            return self.asarray(X, dtype="float32")
+        bits = X.astype("uint32") << 16
+        return bits.view("float32")
+
+    def gemm_compressed(
+        self, X: Floats2d, W: ArrayXd, storage: FloatStorage
+    ) -> Floats2d:
+        """Compute X @ W.T for a weights matrix stored by `compress_floats`, with
+        float32 accumulation.
+        """
+        _check_compressed_weights(X, W, storage)
+        return self.gemm(X, self.decompress_floats(W, storage), trans2=True)
+
+    def sparse_gemm(
+        self, X: Floats2d, data: Floats1d, indices: Ints1d, indptr: Ints1d
+    ) -> Floats2d:
+        """Compute X @ W.T for a weights matrix W of shape (nO, nI) that's stored
+        in compressed sparse row (CSR) form: the non-zero values of row o are
+        data[indptr[o]:indptr[o+1]], in the columns indices[indptr[o]:indptr[o+1]].
+        The work is proportional to the number of non-zeros.
+        """
+        _check_csr(self, X, data, indices, indptr)
+        rows = _get_csr_rows(self, indptr)
+        Y = self.alloc2f(X.shape[0], indptr.shape[0] - 1)
+        # The products are gathered into an (n, nnz) temporary, so X is
+        # processed in blocks of rows to bound its size.
+        for start, end in _get_csr_row_blocks(X.shape[0], data.shape[0]):
+            YT = self.alloc2f(Y.shape[1], end - start)
+            self.scatter_add(YT, rows, (X[start:end, indices] * data).T)
+            Y[start:end] = YT.T
+        return Y
+
+    def backprop_sparse_gemm(
+        self,
+        dY: Floats2d,
+        X: Floats2d,
+        data: Floats1d,
+        indices: Ints1d,
+        indptr: Ints1d,
+    ) -> Tuple[Floats2d, Floats1d]:
+        """The backward pass of `sparse_gemm`: given the gradient of the output,
+        return the gradient of X and of the non-zero values. The gradient of
+        the other entries of W isn't computed, so the sparsity is kept.
+        """
+        _check_csr(self, X, data, indices, indptr)
+        rows = _get_csr_rows(self, indptr)
+        d_data = self.alloc1f(data.shape[0])
+        dX = self.alloc2f(X.shape[0], X.shape[1])
+        for start, end in _get_csr_row_blocks(X.shape[0], data.shape[0]):
+            dY_rows = dY[start:end, rows]
+            d_data += (dY_rows * X[start:end, indices]).sum(axis=0)
+            dXT = self.alloc2f(X.shape[1], end - start)
+            self.scatter_add(dXT, indices, (dY_rows * data).T)
+            dX[start:end] = dXT.T
+        return dX, d_data
+
     def flatten(
         self,
         X: Sequence[ArrayT],
@@ -342,6 +555,25 @@ class Ops:
             unpadded[indices[i]] = data[i, : lengths[i]]
         return cast(List2d, unpadded)
 
+    def dropout(self, X: FloatsXd, rate: float, *, seed: int) -> FloatsXd:
+        """Zero each value of X with probability `rate`, and scale the rest by
+        1 / (1 - rate). The mask is drawn from a counter-based generator keyed
+        by `seed`, so it's never stored: `backprop_dropout` with the same seed
+        and shape regenerates it.
+        """
+        if rate <= 0:
+            return X.copy()
+        elif rate >= 1.0:
+            return self.alloc(X.shape, dtype=X.dtype)
+        keep = _get_dropout_bits(self.xp, X.size, seed) >= _get_dropout_threshold(rate)
+        Y = X * self.xp.reshape(keep, X.shape)
+        Y *= 1.0 / (1.0 - rate)
+        return Y
+
+    def backprop_dropout(self, dY: FloatsXd, rate: float, *, seed: int) -> FloatsXd:
+        """The backward pass of `dropout`, given the seed of the forward pass."""
+        return self.dropout(dY, rate, seed=seed)
+
     def get_dropout_mask(self, shape: Shape, drop: Optional[float]) -> FloatsXd:
         """Create a random mask for applying dropout, with a certain percent of
         the mask (defined by `drop`) will contain zeros. The neurons at those
@@ -416,7 +648,10 @@ class Ops:
         """Allocate an array of a certain shape."""
         if isinstance(shape, int):
             shape = (shape,)
-        return self.xp.zeros(shape, dtype=dtype)
+        array = self.xp.zeros(shape, dtype=dtype)
+        if _memory.active_tracker is not None:
+            _memory.active_tracker.track(array)
+        return array
 
     def reshape1f(self, array: FloatsXd, d0: int) -> Floats1d:
         return cast(Floats1d, self.reshape(array, (d0,)))
@@ -530,16 +765,19 @@ class Ops:
         """Ensure a given array is of the correct type."""
         if isinstance(data, self.xp.ndarray):
             if dtype is not None:
-                return self.xp.asarray(data, dtype=dtype)
+                array = self.xp.asarray(data, dtype=dtype)
             else:
-                return self.xp.asarray(data)
+                array = self.xp.asarray(data)
         elif hasattr(data, "numpy"):
             # Handles PyTorch Tensor
             return data.numpy()  # type: ignore
         elif dtype is not None:
-            return self.xp.array(data, dtype=dtype)
+            array = self.xp.array(data, dtype=dtype)
         else:
-            return self.xp.array(data)
+            array = self.xp.array(data)
+        if _memory.active_tracker is not None and array is not data:
+            _memory.active_tracker.track(array)
+        return array
 
     def as_contig(self, data: ArrayT, dtype: Optional[DTypes] = None) -> ArrayT:
         """Allow the backend to make a contiguous copy of an array.
@@ -576,11 +814,40 @@ class Ops:
 
     def softmax(self, x: FloatsT, *, inplace: bool = False, axis: int = -1) -> FloatsT:
         maxes = self.xp.max(x, axis=axis, keepdims=True)
+        if inplace:
+            x -= maxes
+            self.xp.exp(x, out=x)
+            x /= x.sum(axis=axis, keepdims=True)
+            return x
         shifted = x - maxes
         new_x = self.xp.exp(shifted)
         new_x /= new_x.sum(axis=axis, keepdims=True)
         return new_x
 
+    def softmax_cross_entropy(
+        self, logits: Floats2d, targets: Ints1d
+    ) -> Tuple[Floats2d, Floats1d]:
+        """Compute the softmax of the logits and its cross-entropy loss against
+        integer class targets, without building a one-hot matrix. Returns the
+        gradient of the loss with respect to the logits, which is the softmax
+        minus the one-hot targets, and the loss of each row.
+        """
+        targets = self.asarray1i(targets)
+        N, nC = logits.shape
+        if targets.shape != (N,):
+            raise ValueError(f"Expected {N} targets, got shape {targets.shape}")
+        if N != 0 and (int(targets.min()) < 0 or int(targets.max()) >= nC):
+            err = f"Targets must be class indices between 0 and {nC - 1}"
+            raise ValueError(err)
+        shifted = logits - logits.max(axis=1, keepdims=True)
+        d_logits = self.xp.exp(shifted)
+        sums = d_logits.sum(axis=1, keepdims=True)
+        d_logits /= sums
+        rows = self.xp.arange(N)
+        losses = self.xp.log(sums.ravel()) - shifted[rows, targets]
+        d_logits[rows, targets] -= 1
+        return d_logits, losses
+
     def softmax_sequences(
         self, Xs: Floats2d, lengths: Ints1d, *, inplace: bool = False, axis: int = -1
     ) -> Floats2d:
@@ -607,6 +874,35 @@ class Ops:
         dX -= Y * sum_dX
         return dX
 
+    def parametric_attention(
+        self, X: Floats2d, Q: Floats1d, lengths: Ints1d
+    ) -> Tuple[Floats2d, Floats2d]:
+        """Weight the rows of X by the softmax, within each sequence, of their
+        dot product with the query vector Q. Returns the weighted rows and
+        the (N, 1) attention weights, for `backprop_parametric_attention`.
+        """
+        scores = self.gemm(X, self.reshape2f(Q, -1, 1))
+        attention = self.softmax_sequences(scores, lengths)
+        return X * attention, attention
+
+    def backprop_parametric_attention(
+        self,
+        dY: Floats2d,
+        X: Floats2d,
+        Q: Floats1d,
+        attention: Floats2d,
+        lengths: Ints1d,
+    ) -> Tuple[Floats2d, Floats1d]:
+        """The backward pass of `parametric_attention`. Returns the gradients
+        of X and of Q.
+        """
+        d_attention = (X * dY).sum(axis=1, keepdims=True)
+        d_scores = self.backprop_softmax_sequences(d_attention, attention, lengths)
+        dQ = self.gemm(X, d_scores, trans1=True)
+        dX = dY * attention
+        dX += self.xp.outer(d_scores, Q)
+        return dX, self.reshape1f(dQ, dQ.size)
+
     def recurrent_lstm(
         self,
         W: Floats2d,
@@ -694,6 +990,42 @@ class Ops:
         out[indices] = dXsub
         return out
 
+    def layer_norm(
+        self, X: Floats2d, G: Floats1d, b: Floats1d, *, eps: float = 1e-8
+    ) -> Tuple[Floats2d, Floats1d, Floats1d]:
+        """Normalize each row of X to zero mean and unit variance, then scale
+        and shift it by G and b. Returns the output, and the mean and the
+        inverse standard deviation of each row, for `backprop_layer_norm`.
+        """
+        mean = X.mean(axis=1)
+        inv_std = (X.var(axis=1) + eps) ** -0.5
+        Y = X - mean.reshape((-1, 1))
+        Y *= inv_std.reshape((-1, 1))
+        Y *= G
+        Y += b
+        return Y, mean, inv_std
+
+    def backprop_layer_norm(
+        self,
+        dY: Floats2d,
+        X: Floats2d,
+        G: Floats1d,
+        mean: Floats1d,
+        inv_std: Floats1d,
+    ) -> Tuple[Floats2d, Floats1d, Floats1d]:
+        """The backward pass of `layer_norm`. Returns the gradients of X, G
+        and b.
+        """
+        Xhat = X - mean.reshape((-1, 1))
+        Xhat *= inv_std.reshape((-1, 1))
+        dG = (dY * Xhat).sum(axis=0)
+        db = dY.sum(axis=0)
+        dXhat = dY * G
+        dX = dXhat - dXhat.mean(axis=1, keepdims=True)
+        dX -= Xhat * (dXhat * Xhat).mean(axis=1, keepdims=True)
+        dX *= inv_std.reshape((-1, 1))
+        return dX, dG, db
+
     def update_averages(
         self, ema: FloatsT, weights: FloatsT, t: int, max_decay: float = 0.9999
     ) -> None:
@@ -810,6 +1142,18 @@ class Ops:
             numpy_ops.ngrams(n, numpy_ops.asarray(keys, dtype="uint64"))
         )
 
+    def unique_keys(self, keys: Ints1d) -> Tuple[Ints1d, Ints1d, Ints1d]:
+        """Find the unique values of a sequence of 64-bit keys, using a hash
+        table. Returns the index of the first occurrence of each unique key,
+        ordered by first occurrence, the index of each key's unique value, and
+        the number of occurrences of each unique key.
+        """
+        from .numpy_ops import NumpyOps
+
+        numpy_ops = NumpyOps()
+        ind, inv, counts = numpy_ops.unique_keys(numpy_ops.asarray(keys))
+        return self.asarray1i(ind), self.asarray1i(inv), self.asarray1i(counts)
+
     def position_encode(
         self, N: int, D: int, period: int = 10000, out: Optional[Floats2d] = None
     ) -> Floats2d:
@@ -1024,3 +1368,136 @@ def dsigmoid(Y: ArrayT) -> ArrayT:
 
 def dtanh(Y: ArrayT) -> ArrayT:
     return 1 - Y ** 2
+
+
+def _get_seq2col_bounds(
+    ops: Ops, B: int, lengths: Optional[Ints1d]
+) -> Tuple[Ints1d, Ints1d, Ints1d]:
+    """Get the index of each row, and the start and end of its sequence."""
+    rows = ops.xp.arange(B)
+    if lengths is None:
+        return rows, ops.xp.zeros((B,), dtype="i"), ops.xp.full((B,), B, dtype="i")
+    lengths = ops.asarray1i(lengths)
+    if int(lengths.sum()) != B:
+        raise ValueError(f"seq2col lengths sum to {int(lengths.sum())}, not {B}")
+    ends = ops.xp.cumsum(lengths)
+    return rows, ops.xp.repeat(ends - lengths, lengths), ops.xp.repeat(ends, lengths)
+
+
+# The dropout generator hashes each element's index together with the seed
+# (the SplitMix64 finalizer), and compares the top 24 bits of the hash to the
+# dropout rate. NumpyOps implements the same function natively, so the
+# masks are identical across backends.
+_SPLITMIX_GAMMA = 0x9E3779B97F4A7C15
+_SPLITMIX_MUL1 = 0xBF58476D1CE4E5B9
+_SPLITMIX_MUL2 = 0x94D049BB133111EB
+
+
+def _get_dropout_threshold(rate: float) -> int:
+    return min(int(rate * (1 << 24) + 0.5), 1 << 24)
+
+
+def _get_dropout_bits(xp: Xp, size: int, seed: int) -> IntsXd:
+    u64 = xp.uint64
+    z = xp.arange(1, size + 1, dtype="uint64") * u64(_SPLITMIX_GAMMA)
+    z += u64(seed & 0xFFFFFFFFFFFFFFFF)
+    z ^= z >> u64(30)
+    z *= u64(_SPLITMIX_MUL1)
+    z ^= z >> u64(27)
+    z *= u64(_SPLITMIX_MUL2)
+    z ^= z >> u64(31)
+    return z >> u64(40)
+
+
+def _check_int8_shapes(X: Floats2d, W: Ints2d, W_scale: Floats1d) -> None:
+    if X.ndim != 2 or W.ndim != 2 or X.shape[1] != W.shape[1]:
+        err = f"Mismatched shapes for int8 GEMM: X {X.shape}, W {W.shape}"
+        raise ValueError(err)
+    if W_scale.shape != (W.shape[0],):
+        err = f"Expected one scale per row of W {W.shape}, got {W_scale.shape}"
+        raise ValueError(err)
+
+
+def _get_int8_input_scales(
+    ops: Ops, X: Floats2d, X_scale: Optional[float]
+) -> Floats1d:
+    """Get the quantization scale of each row of the input of an int8 GEMM."""
+    if X_scale is not None:
+        if not X_scale > 0:
+            raise ValueError(f"Invalid input scale for int8 GEMM: {X_scale}")
+        return ops.xp.full((X.shape[0],), X_scale, dtype="float32")
+    if X.shape[1] == 0:
+        return ops.xp.ones((X.shape[0],), dtype="float32")
+    scales = ops.xp.abs(X).max(axis=1) / ops.xp.float32(127.0)
+    return ops.xp.where(scales == 0, ops.xp.float32(1.0), scales).astype("float32")
+
+
+def _check_storage(storage: str) -> None:
+    if storage not in ("float32", "float16", "bfloat16"):
+        err = f"Invalid float storage: '{storage}'. Expected float32, float16 or bfloat16"
+        raise ValueError(err)
+
+
+def _check_compressed_weights(X: Floats2d, W: ArrayXd, storage: str) -> None:
+    _check_storage(storage)
+    if W.ndim != 2 or X.ndim != 2 or W.shape[1] != X.shape[1]:
+        err = f"Mismatched shapes for compressed GEMM: {X.shape} and {W.shape}"
+        raise ValueError(err)
+    dtype = "uint16" if storage == "bfloat16" else storage
+    if W.dtype != dtype:
+        raise ValueError(f"Expected {storage} weights stored as {dtype}, got {W.dtype}")
+
+
+def _check_csr(
+    ops: Ops, X: Floats2d, data: Floats1d, indices: Ints1d, indptr: Ints1d
+) -> None:
+    nnz = int(indptr[-1]) if indptr.shape[0] else -1
+    if data.shape != indices.shape or data.shape[0] != nnz or indptr[0] != 0:
+        err = f"Invalid CSR weights: {data.shape[0]} values, {indices.shape[0]} indices, {indptr.shape[0]} row pointers"
+        raise ValueError(err)
+    if ops.xp.any(indptr[1:] < indptr[:-1]):
+        raise ValueError("Invalid CSR weights: row pointers must be increasing")
+    if nnz and (int(indices.min()) < 0 or int(indices.max()) >= X.shape[1]):
+        raise ValueError(f"Invalid CSR weights: column index out of range {X.shape}")
+
+
+def _get_csr_rows(ops: Ops, indptr: Ints1d) -> Ints1d:
+    """Get the row of each non-zero value of a CSR matrix."""
+    n_rows = indptr.shape[0] - 1
+    counts = indptr[1:] - indptr[:-1]
+    return ops.xp.repeat(ops.xp.arange(n_rows, dtype="int32"), counts)
+
+
+# The number of values in the (rows, nnz) temporaries of the generic sparse
+# GEMM, i.e. about 16 MB.
+_CSR_BLOCK_SIZE = 1 << 22
+
+
+def _get_csr_row_blocks(n_rows: int, nnz: int) -> Iterator[Tuple[int, int]]:
+    """Split the rows of the input of a sparse GEMM into blocks, so that the
+    temporaries of the generic implementation stay small.
+    """
+    block_size = max(1, _CSR_BLOCK_SIZE // max(nnz, 1))
+    for start in range(0, n_rows, block_size):
+        yield start, min(start + block_size, n_rows)
+
+
+def _get_window_weights(
+    ops: Ops, W: Union[Floats2d, Floats3d], nW: int
+) -> Floats3d:
+    """Get the weights of a window layer in the packed (nF, nO, I) layout."""
+    if W.ndim == 3:
+        return cast(Floats3d, W)
+    return ops.pack_window_weights(cast(Floats2d, W), nW)
+
+
+def _get_window_dropped(
+    ops: Ops, bounds: Tuple[Ints1d, Ints1d, Ints1d], lo: int, n: int, d: int
+) -> Ints1d:
+    """Find the rows of the block X[lo : lo + n] whose source at the offset d
+    lies in a different sequence, relative to the start of the block.
+    """
+    rows, row_starts, row_ends = bounds
+    src = rows[lo : lo + n] + d
+    dropped = (src < row_starts[lo : lo + n]) | (src >= row_ends[lo : lo + n])
+    return ops.xp.nonzero(dropped)[0]
@@ -0,0 +1,12 @@
+from .ops import run_benchmarks as run_ops_benchmarks
+from .training import run_benchmarks as run_training_benchmarks
+from .util import compare_results, format_results, format_comparison
+
+
+__all__ = [
+    "run_ops_benchmarks",
+    "run_training_benchmarks",
+    "compare_results",
+    "format_results",
+    "format_comparison",
+]
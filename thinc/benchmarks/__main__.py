@@ -0,0 +1,94 @@
+"""Run the benchmarks from the command line.
+
+    python -m thinc.benchmarks ops --output results.json
+    python -m thinc.benchmarks ops --compare baseline.json --threshold 0.1
+    python -m thinc.benchmarks training --steps 50 --output training.json
+    python -m thinc.benchmarks compare results.json baseline.json
+
+Comparisons exit with status 1 if any benchmark regressed by more than the
+threshold, so they can be used as a gate in CI.
+"""
+from typing import Any, Dict, List, Optional
+import argparse
+import sys
+import srsly
+
+from .ops import run_benchmarks as run_ops_benchmarks
+from .training import run_benchmarks as run_training_benchmarks, format_phases
+from .util import compare_results, format_results, format_comparison
+
+
+COMMANDS = ("ops", "training", "compare")
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    argv = list(sys.argv[1:] if argv is None else argv)
+    if not argv or argv[0] not in COMMANDS + ("-h", "--help"):
+        argv.insert(0, "ops")
+    args = _make_parser().parse_args(argv)
+    if args.command == "compare":
+        results = srsly.read_json(args.results)
+        baseline = srsly.read_json(args.baseline)
+        return _compare(results, baseline, args.threshold)
+    if args.command == "training":
+        results = run_training_benchmarks(
+            names=args.model, n_steps=args.steps, batch_size=args.batch_size
+        )
+    else:
+        results = run_ops_benchmarks(
+            backends=args.backend,
+            pattern=args.filter,
+            repeat=args.repeat,
+            min_time=args.min_time,
+        )
+    print(format_results(results))
+    if args.command == "training":
+        print(format_phases(results))
+    if args.output:
+        srsly.write_json(args.output, results)
+    if args.compare:
+        return _compare(results, srsly.read_json(args.compare), args.threshold)
+    return 0
+
+
+def _compare(
+    results: Dict[str, Any], baseline: Dict[str, Any], threshold: float
+) -> int:
+    comparison = compare_results(results, baseline, threshold=threshold)
+    print(format_comparison(comparison))
+    regressions = [c for c in comparison if c["regression"]]
+    if regressions:
+        print(f"{len(regressions)} regression(s) beyond {threshold:.0%}")
+        return 1
+    return 0
+
+
+def _make_parser() -> argparse.ArgumentParser:
+    parser = argparse.ArgumentParser(prog="python -m thinc.benchmarks")
+    commands = parser.add_subparsers(dest="command")
+    ops = commands.add_parser("ops", help="Time the Ops kernels")
+    ops.add_argument("--backend", action="append", help="Backend name, e.g. numpy")
+    ops.add_argument("--filter", help="Regular expression for benchmark names")
+    ops.add_argument("--repeat", type=int, default=5, help="Timed rounds")
+    ops.add_argument("--min-time", type=float, default=0.05, help="Seconds per round")
+    training = commands.add_parser("training", help="Train the reference models")
+    training.add_argument("--model", action="append", help="Reference model name")
+    training.add_argument("--steps", type=int, default=50, help="Training steps")
+    training.add_argument("--batch-size", type=int, default=32, help="Docs per batch")
+    for command in (ops, training):
+        command.add_argument("--output", help="Path to write the JSON results to")
+        command.add_argument("--compare", help="Path to JSON results to compare to")
+        command.add_argument(
+            "--threshold", type=float, default=0.1, help="Allowed slowdown"
+        )
+    compare = commands.add_parser("compare", help="Compare two JSON results")
+    compare.add_argument("results", help="Path to the new JSON results")
+    compare.add_argument("baseline", help="Path to the baseline JSON results")
+    compare.add_argument(
+        "--threshold", type=float, default=0.1, help="Allowed slowdown"
+    )
+    return parser
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,334 @@
+"""Micro-benchmarks for the Ops kernels. Each benchmark has a setup function,
+that takes the Ops and the shape parameters and returns a callable to time.
+The inputs are created up front, so only the kernel itself is timed.
+"""
+from typing import Any, Callable, Dict, List, Optional, Tuple
+import re
+import numpy
+
+from ..backends import Ops
+from .util import get_backends, get_metadata, time_func
+
+
+SetupT = Callable[..., Callable[[], Any]]
+
+BENCHMARKS: List[Tuple[str, str, SetupT, Tuple[int, ...]]] = []
+
+
+def benchmark(name: str, *shapes: Tuple[int, ...]) -> Callable[[SetupT], SetupT]:
+    """Register a setup function as a benchmark, run once for each shape."""
+
+    def register(setup: SetupT) -> SetupT:
+        for shape in shapes:
+            label = "x".join(str(dim) for dim in shape)
+            BENCHMARKS.append((name, label, setup, shape))
+        return setup
+
+    return register
+
+
+def _floats(ops: Ops, *shape: int) -> Any:
+    rng = numpy.random.RandomState(0)
+    return ops.asarray(rng.uniform(-1.0, 1.0, shape).astype("float32"))
+
+
+def _lengths(ops: Ops, n_seqs: int, mean: int) -> Any:
+    rng = numpy.random.RandomState(0)
+    lengths = rng.randint(1, 2 * mean, size=(n_seqs,))
+    return ops.asarray1i(lengths)
+
+
+# Shapes are (batch size, input width, output width), or (number of
+# sequences, mean length, width) for the sequence kernels.
+
+
+@benchmark("gemm", (256, 128, 128), (2048, 300, 300), (64, 768, 3072))
+def gemm(ops: Ops, N: int, nI: int, nO: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nI)
+    W = _floats(ops, nO, nI)
+    out = ops.alloc2f(N, nO)
+    return lambda: ops.gemm(X, W, trans2=True, out=out)
+
+
+@benchmark("gemm_int8", (8, 768, 768), (256, 128, 128), (64, 768, 3072))
+def gemm_int8(ops: Ops, N: int, nI: int, nO: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nI)
+    W_int8, W_scale = ops.quantize_int8(_floats(ops, nO, nI))
+    return lambda: ops.gemm_int8(X, W_int8, W_scale)
+
+
+@benchmark("gemm_bfloat16", (8, 768, 768), (16, 768, 3072), (256, 128, 128))
+def gemm_bfloat16(ops: Ops, N: int, nI: int, nO: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nI)
+    W = ops.compress_floats(_floats(ops, nO, nI), "bfloat16")
+    return lambda: ops.gemm_compressed(X, W, "bfloat16")
+
+
+@benchmark("sparse_gemm", (256, 128, 128), (64, 768, 3072))
+def sparse_gemm(ops: Ops, N: int, nI: int, nO: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nI)
+    # Keep the largest 10% of the weights, as after magnitude pruning.
+    W = _floats(ops, nO, nI)
+    W[ops.xp.abs(W) < 0.9] = 0
+    rows, cols = ops.xp.nonzero(W)
+    indptr = ops.alloc1i(nO + 1)
+    indptr[1:] = ops.xp.cumsum((W != 0).sum(axis=1))
+    data = ops.as_contig(W[rows, cols])
+    indices = ops.asarray1i(cols)
+    return lambda: ops.sparse_gemm(X, data, indices, indptr)
+
+
+@benchmark("affine", (256, 128, 128), (2048, 300, 300))
+def affine(ops: Ops, N: int, nI: int, nO: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nI)
+    W = _floats(ops, nO, nI)
+    b = _floats(ops, nO)
+    return lambda: ops.affine(X, W, b)
+
+
+@benchmark("seq2col", (2048, 96, 1), (2048, 300, 2))
+def seq2col(ops: Ops, N: int, nI: int, nW: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nI)
+    return lambda: ops.seq2col(X, nW)
+
+
+@benchmark("backprop_seq2col", (2048, 96, 1), (2048, 300, 2))
+def backprop_seq2col(ops: Ops, N: int, nI: int, nW: int) -> Callable[[], Any]:
+    dY = _floats(ops, N, nI * (2 * nW + 1))
+    return lambda: ops.backprop_seq2col(dY, nW)
+
+
+@benchmark("window_gemm", (2048, 96, 288, 1), (2048, 300, 900, 2))
+def window_gemm(ops: Ops, N: int, nI: int, nO: int, nW: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nI)
+    W = _floats(ops, nO, nI * (2 * nW + 1))
+    return lambda: ops.window_gemm(X, W, nW)
+
+
+@benchmark("backprop_window_gemm", (2048, 96, 288, 1), (2048, 300, 900, 2))
+def backprop_window_gemm(
+    ops: Ops, N: int, nI: int, nO: int, nW: int
+) -> Callable[[], Any]:
+    X = _floats(ops, N, nI)
+    W = _floats(ops, nO, nI * (2 * nW + 1))
+    dY = _floats(ops, N, nO)
+    return lambda: ops.backprop_window_gemm(dY, X, W, nW)
+
+
+@benchmark("maxout", (2048, 96, 3), (2048, 300, 3))
+def maxout(ops: Ops, N: int, nO: int, nP: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nO, nP)
+    return lambda: ops.maxout(X)
+
+
+@benchmark("backprop_maxout", (2048, 96, 3), (2048, 300, 3))
+def backprop_maxout(ops: Ops, N: int, nO: int, nP: int) -> Callable[[], Any]:
+    _, which = ops.maxout(_floats(ops, N, nO, nP))
+    dY = _floats(ops, N, nO)
+    return lambda: ops.backprop_maxout(dY, which, nP)
+
+
+@benchmark("mish", (2048, 96), (2048, 300))
+def mish(ops: Ops, N: int, nO: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nO)
+    return lambda: ops.mish(X)
+
+
+@benchmark("backprop_mish", (2048, 96), (2048, 300))
+def backprop_mish(ops: Ops, N: int, nO: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nO)
+    dY = _floats(ops, N, nO)
+    return lambda: ops.backprop_mish(dY, X)
+
+
+@benchmark("layer_norm", (2048, 96), (2048, 300))
+def layer_norm(ops: Ops, N: int, nO: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nO)
+    G = _floats(ops, nO)
+    b = _floats(ops, nO)
+    return lambda: ops.layer_norm(X, G, b)
+
+
+@benchmark("backprop_layer_norm", (2048, 96), (2048, 300))
+def backprop_layer_norm(ops: Ops, N: int, nO: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nO)
+    G = _floats(ops, nO)
+    dY = _floats(ops, N, nO)
+    _, mean, inv_std = ops.layer_norm(X, G, G)
+    return lambda: ops.backprop_layer_norm(dY, X, G, mean, inv_std)
+
+
+@benchmark("relu", (2048, 96), (2048, 300))
+def relu(ops: Ops, N: int, nO: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nO)
+    return lambda: ops.relu(X)
+
+
+@benchmark("softmax", (2048, 50), (256, 5000))
+def softmax(ops: Ops, N: int, nO: int) -> Callable[[], Any]:
+    X = _floats(ops, N, nO)
+    return lambda: ops.softmax(X)
+
+
+@benchmark("softmax_sequences", (64, 30, 1), (256, 30, 4))
+def softmax_sequences(ops: Ops, n_seqs: int, mean: int, nO: int) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    X = _floats(ops, int(lengths.sum()), nO)
+    return lambda: ops.softmax_sequences(X, lengths)
+
+
+@benchmark("backprop_softmax_sequences", (64, 30, 1), (256, 30, 4))
+def backprop_softmax_sequences(
+    ops: Ops, n_seqs: int, mean: int, nO: int
+) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    Y = ops.softmax_sequences(_floats(ops, int(lengths.sum()), nO), lengths)
+    dY = _floats(ops, *Y.shape)
+    return lambda: ops.backprop_softmax_sequences(dY, Y, lengths)
+
+
+@benchmark("parametric_attention", (64, 30, 96), (256, 30, 300))
+def parametric_attention(
+    ops: Ops, n_seqs: int, mean: int, nO: int
+) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    X = _floats(ops, int(lengths.sum()), nO)
+    Q = _floats(ops, nO)
+    return lambda: ops.parametric_attention(X, Q, lengths)
+
+
+@benchmark("backprop_parametric_attention", (64, 30, 96), (256, 30, 300))
+def backprop_parametric_attention(
+    ops: Ops, n_seqs: int, mean: int, nO: int
+) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    X = _floats(ops, int(lengths.sum()), nO)
+    Q = _floats(ops, nO)
+    dY = _floats(ops, *X.shape)
+    _, attention = ops.parametric_attention(X, Q, lengths)
+    return lambda: ops.backprop_parametric_attention(dY, X, Q, attention, lengths)
+
+
+@benchmark("reduce_sum", (64, 30, 96), (256, 30, 300))
+def reduce_sum(ops: Ops, n_seqs: int, mean: int, nO: int) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    X = _floats(ops, int(lengths.sum()), nO)
+    return lambda: ops.reduce_sum(X, lengths)
+
+
+@benchmark("reduce_mean", (64, 30, 96), (256, 30, 300))
+def reduce_mean(ops: Ops, n_seqs: int, mean: int, nO: int) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    X = _floats(ops, int(lengths.sum()), nO)
+    return lambda: ops.reduce_mean(X, lengths)
+
+
+@benchmark("reduce_max", (64, 30, 96), (256, 30, 300))
+def reduce_max(ops: Ops, n_seqs: int, mean: int, nO: int) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    X = _floats(ops, int(lengths.sum()), nO)
+    return lambda: ops.reduce_max(X, lengths)
+
+
+@benchmark("backprop_reduce_sum", (64, 30, 96), (256, 30, 300))
+def backprop_reduce_sum(ops: Ops, n_seqs: int, mean: int, nO: int) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    dY = _floats(ops, n_seqs, nO)
+    return lambda: ops.backprop_reduce_sum(dY, lengths)
+
+
+@benchmark("backprop_reduce_mean", (64, 30, 96), (256, 30, 300))
+def backprop_reduce_mean(
+    ops: Ops, n_seqs: int, mean: int, nO: int
+) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    dY = _floats(ops, n_seqs, nO)
+    return lambda: ops.backprop_reduce_mean(dY, lengths)
+
+
+@benchmark("backprop_reduce_max", (64, 30, 96), (256, 30, 300))
+def backprop_reduce_max(ops: Ops, n_seqs: int, mean: int, nO: int) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    _, which = ops.reduce_max(_floats(ops, int(lengths.sum()), nO), lengths)
+    dY = _floats(ops, n_seqs, nO)
+    return lambda: ops.backprop_reduce_max(dY, which, lengths)
+
+
+@benchmark("hash", (10000,), (100000,))
+def hash_ids(ops: Ops, N: int) -> Callable[[], Any]:
+    ids = ops.asarray(numpy.arange(N, dtype="uint64"))
+    return lambda: ops.hash(ids, 1)
+
+
+@benchmark("scatter_add", (5000, 20000, 96), (50000, 20000, 300))
+def scatter_add(ops: Ops, nV: int, N: int, nO: int) -> Callable[[], Any]:
+    rng = numpy.random.RandomState(0)
+    table = ops.alloc2f(nV, nO)
+    ids = ops.asarray1i(rng.randint(0, nV, size=(N,)))
+    values = _floats(ops, N, nO)
+    return lambda: ops.scatter_add(table, ids, values)
+
+
+@benchmark("unique_keys", (5000, 20000), (50000, 200000))
+def unique_keys(ops: Ops, nV: int, N: int) -> Callable[[], Any]:
+    rng = numpy.random.RandomState(0)
+    keys = rng.zipf(1.2, size=(N,)) % nV
+    return lambda: ops.unique_keys(ops.asarray(keys.astype("uint64")))
+
+
+@benchmark("adam", (100000,), (10000000,))
+def adam(ops: Ops, N: int) -> Callable[[], Any]:
+    weights = _floats(ops, N)
+    gradient = _floats(ops, N) * 1e-3
+    mom1 = ops.alloc1f(N)
+    mom2 = ops.alloc1f(N)
+    return lambda: ops.adam(weights, gradient, mom1, mom2, 0.9, 0.999, 1e-8, 1e-3)
+
+
+@benchmark("list2padded", (64, 30, 96), (256, 30, 300))
+def list2padded(ops: Ops, n_seqs: int, mean: int, nO: int) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    seqs = ops.unflatten(_floats(ops, int(lengths.sum()), nO), lengths)
+    return lambda: ops.list2padded(seqs)
+
+
+@benchmark("padded2list", (64, 30, 96), (256, 30, 300))
+def padded2list(ops: Ops, n_seqs: int, mean: int, nO: int) -> Callable[[], Any]:
+    lengths = _lengths(ops, n_seqs, mean)
+    seqs = ops.unflatten(_floats(ops, int(lengths.sum()), nO), lengths)
+    padded = ops.list2padded(seqs)
+    return lambda: ops.padded2list(padded)
+
+
+def run_benchmarks(
+    *,
+    backends: Optional[List[str]] = None,
+    pattern: Optional[str] = None,
+    repeat: int = 5,
+    min_time: float = 0.05,
+) -> Dict[str, Any]:
+    """Run the Ops benchmarks, and return the results in a JSON-serializable
+    dict. Benchmarks can be selected with a regular expression `pattern` that
+    is matched against their names. A benchmark that fails on a backend is
+    recorded with its error instead of a timing.
+    """
+    results = []
+    for ops in get_backends(backends):
+        for name, label, setup, shape in BENCHMARKS:
+            if pattern is not None and not re.search(pattern, name):
+                continue
+            result: Dict[str, Any] = {
+                "suite": "ops",
+                "backend": ops.name,
+                "name": name,
+                "label": label,
+                "unit": "s",
+            }
+            try:
+                result.update(
+                    time_func(ops, setup(ops, *shape), repeat=repeat, min_time=min_time)
+                )
+            except Exception as e:
+                result["error"] = f"{type(e).__name__}: {e}"
+            results.append(result)
+    return {"meta": get_metadata(), "results": results}
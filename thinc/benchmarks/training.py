@@ -0,0 +1,391 @@
+"""End-to-end training benchmarks. Reference models are built from config
+strings, and trained for a fixed number of steps on synthetic data generated
+from a fixed seed, so runs can be compared across changes to the Ops, the
+Model or the optimizers.
+"""
+from typing import Any, Callable, Dict, List, Optional, Tuple
+import multiprocessing
+import sys
+import time
+import traceback
+import numpy
+from wasabi import table
+
+from ..api import Config, registry, Model, Adam, fix_random_seed, get_current_ops
+from ..api import chain, clone, residual, with_array, with_padded, list2ragged
+from ..api import HashEmbed, Maxout, Softmax, LSTM, SparseLinear
+from ..api import ParametricAttention, WindowedMaxout, expand_window, reduce_sum
+from ..types import Ints1d
+from .util import get_metadata, synchronize
+
+try:
+    import resource
+except ImportError:  # pragma: no cover
+    resource = None  # type: ignore
+
+
+DATA_CONFIG = """
+[data]
+n_vocab = 20000
+n_tags = 20
+n_classes = 4
+min_length = 5
+max_length = 40
+"""
+
+CONFIGS = {
+    "cnn_tagger": DATA_CONFIG
+    + """
+[model]
+@layers = "benchmarks.CNNTagger.v1"
+width = 128
+depth = 4
+window_size = 1
+n_vocab = 5000
+n_tags = ${data:n_tags}
+""",
+    "cnn_windowed_tagger": DATA_CONFIG
+    + """
+[model]
+@layers = "benchmarks.CNNTagger.v2"
+width = 128
+depth = 4
+window_size = 1
+n_vocab = 5000
+n_tags = ${data:n_tags}
+""",
+    "lstm_tagger": DATA_CONFIG
+    + """
+[model]
+@layers = "benchmarks.LSTMTagger.v1"
+width = 128
+depth = 1
+n_vocab = 5000
+n_tags = ${data:n_tags}
+""",
+    "sparse_textcat": DATA_CONFIG
+    + """
+[model]
+@layers = "benchmarks.BagOfNgramsClassifier.v1"
+n_classes = ${data:n_classes}
+length = 262144
+""",
+    "attention_textcat": DATA_CONFIG
+    + """
+[model]
+@layers = "benchmarks.AttentionClassifier.v1"
+width = 128
+n_vocab = 5000
+n_classes = ${data:n_classes}
+""",
+}
+
+
+@registry.layers("benchmarks.CNNTagger.v1")
+def build_cnn_tagger(
+    width: int, depth: int, window_size: int, n_vocab: int, n_tags: int
+) -> Model:
+    cnn = residual(
+        chain(
+            expand_window(window_size=window_size),
+            Maxout(nO=width, nI=width * (window_size * 2 + 1), nP=3, normalize=True),
+        )
+    )
+    return with_array(
+        chain(HashEmbed(width, n_vocab), clone(cnn, depth), Softmax(n_tags, width))
+    )
+
+
+@registry.layers("benchmarks.CNNTagger.v2")
+def build_cnn_windowed_tagger(
+    width: int, depth: int, window_size: int, n_vocab: int, n_tags: int
+) -> Model:
+    """The CNN tagger of benchmarks.CNNTagger.v1, with WindowedMaxout layers
+    instead of expand_window and Maxout.
+    """
+    cnn = residual(
+        WindowedMaxout(
+            nO=width, nI=width, nP=3, window_size=window_size, normalize=True
+        )
+    )
+    return with_array(
+        chain(HashEmbed(width, n_vocab), clone(cnn, depth), Softmax(n_tags, width))
+    )
+
+
+@registry.layers("benchmarks.LSTMTagger.v1")
+def build_lstm_tagger(width: int, depth: int, n_vocab: int, n_tags: int) -> Model:
+    return chain(
+        with_array(HashEmbed(width, n_vocab)),
+        with_padded(LSTM(width, width, depth=depth)),
+        with_array(Softmax(n_tags, width)),
+    )
+
+
+@registry.layers("benchmarks.BagOfNgramsClassifier.v1")
+def build_bag_of_ngrams_classifier(n_classes: int, length: int) -> Model:
+    return SparseLinear(n_classes, length=length)
+
+
+@registry.layers("benchmarks.AttentionClassifier.v1")
+def build_attention_classifier(width: int, n_vocab: int, n_classes: int) -> Model:
+    return chain(
+        with_array(HashEmbed(width, n_vocab)),
+        list2ragged(),
+        ParametricAttention(width),
+        reduce_sum(),
+        Softmax(n_classes, width),
+    )
+
+
+def make_data(
+    n_docs: int,
+    *,
+    n_vocab: int,
+    n_tags: int,
+    n_classes: int,
+    min_length: int,
+    max_length: int,
+    seed: int = 0,
+) -> Tuple[List[Ints1d], List[Ints1d], Ints1d]:
+    """Generate token IDs, per-token tags and per-document classes. The labels
+    are a function of the tokens, so the models have something to learn.
+    """
+    rng = numpy.random.RandomState(seed)
+    lengths = rng.randint(min_length, max_length + 1, size=(n_docs,))
+    docs = [rng.randint(0, n_vocab, size=(n,)).astype("uint64") for n in lengths]
+    tags = [(doc % n_tags).astype("i") for doc in docs]
+    classes = numpy.asarray([doc[0] % n_classes for doc in docs], dtype="i")
+    return docs, tags, classes
+
+
+def run_benchmarks(
+    *,
+    names: Optional[List[str]] = None,
+    n_steps: int = 50,
+    batch_size: int = 32,
+    seed: int = 0,
+) -> Dict[str, Any]:
+    """Train each reference model for `n_steps` batches, then run inference
+    over the same documents. Returns the results in a JSON-serializable dict,
+    with the throughput in words per second, the time spent in each phase and
+    the peak resident set size (RSS).
+
+    On CPU, each benchmark runs in a forked process, so the peak RSS is that
+    benchmark's own. Otherwise the benchmarks run in this process, and the
+    peak RSS is the peak of the whole process so far, which "peak_rss_scope"
+    records as "process".
+    """
+    names = list(CONFIGS) if names is None else names
+    results = []
+    for name in names:
+        if name not in CONFIGS:
+            err = f"Unknown benchmark: '{name}'. Choose from {list(CONFIGS)}"
+            raise ValueError(err)
+    isolate = _can_fork()
+    for name in names:
+        if isolate:
+            results.extend(_run_forked(name, n_steps, batch_size, seed))
+        else:
+            results.extend(_run_benchmark(name, n_steps, batch_size, seed))
+    return {"meta": get_metadata(), "results": results}
+
+
+def _can_fork() -> bool:
+    # Forking after the GPU is initialized isn't safe, so the GPU backends run
+    # in-process.
+    if "fork" not in multiprocessing.get_all_start_methods():  # pragma: no cover
+        return False
+    return get_current_ops().device_type == "cpu"
+
+
+def _run_forked(
+    name: str, n_steps: int, batch_size: int, seed: int
+) -> List[Dict[str, Any]]:
+    context = multiprocessing.get_context("fork")
+    parent_conn, child_conn = context.Pipe()
+    proc = context.Process(
+        target=_run_child, args=(child_conn, name, n_steps, batch_size, seed)
+    )
+    proc.start()
+    child_conn.close()
+    try:
+        status, value = parent_conn.recv()
+    except EOFError:
+        status, value = "error", f"exit code {proc.exitcode}"
+    finally:
+        proc.join()
+        parent_conn.close()
+    if status != "ok":
+        raise RuntimeError(f"Benchmark '{name}' failed:\n{value}")
+    for result in value:
+        result["peak_rss_scope"] = "benchmark"
+    return value
+
+
+def _run_child(
+    conn: Any, name: str, n_steps: int, batch_size: int, seed: int
+) -> None:
+    try:
+        conn.send(("ok", _run_benchmark(name, n_steps, batch_size, seed)))
+    except Exception:
+        conn.send(("error", traceback.format_exc()))
+    finally:
+        conn.close()
+
+
+def _run_benchmark(
+    name: str, n_steps: int, batch_size: int, seed: int
+) -> List[Dict[str, Any]]:
+    fix_random_seed(seed)
+    config = registry.make_from_config(Config().from_str(CONFIGS[name]))
+    model = config["model"]
+    docs, tags, classes = make_data(n_steps * batch_size, seed=seed, **config["data"])
+    is_tagger = name.endswith("_tagger")
+    n_labels = config["data"]["n_tags" if is_tagger else "n_classes"]
+    make_batch = _make_batcher(name, model)
+    X = make_batch(docs[:batch_size])
+    Y = _make_truths(
+        model, is_tagger, n_labels, tags[:batch_size], classes[:batch_size]
+    )
+    model.initialize(X=X, Y=Y if is_tagger else None)
+    optimizer = Adam(0.001)
+    phases = {"batching": 0.0, "forward": 0.0, "backward": 0.0, "optimizer": 0.0}
+    n_words = 0
+    for start in range(0, len(docs), batch_size):
+        batch_docs = docs[start : start + batch_size]
+        t0 = time.perf_counter()
+        X = make_batch(batch_docs)
+        truths = _make_truths(
+            model,
+            is_tagger,
+            n_labels,
+            tags[start : start + batch_size],
+            classes[start : start + batch_size],
+        )
+        t1 = time.perf_counter()
+        Yh, backprop = model.begin_update(X)
+        synchronize(model.ops)
+        t2 = time.perf_counter()
+        backprop(_get_grad(Yh, truths))
+        synchronize(model.ops)
+        t3 = time.perf_counter()
+        model.finish_update(optimizer)
+        synchronize(model.ops)
+        t4 = time.perf_counter()
+        phases["batching"] += t1 - t0
+        phases["forward"] += t2 - t1
+        phases["backward"] += t3 - t2
+        phases["optimizer"] += t4 - t3
+        n_words += sum(len(doc) for doc in batch_docs)
+    train_time = sum(phases.values())
+    predict_phases = {"batching": 0.0, "forward": 0.0}
+    for start in range(0, len(docs), batch_size):
+        t0 = time.perf_counter()
+        X = make_batch(docs[start : start + batch_size])
+        t1 = time.perf_counter()
+        model.predict(X)
+        synchronize(model.ops)
+        t2 = time.perf_counter()
+        predict_phases["batching"] += t1 - t0
+        predict_phases["forward"] += t2 - t1
+    predict_time = sum(predict_phases.values())
+    shared = {
+        "suite": "training",
+        "backend": model.ops.name,
+        "name": name,
+        "metric": "words_per_second",
+        "higher_is_better": True,
+        "unit": "words/s",
+        "n_steps": n_steps,
+        "batch_size": batch_size,
+        "n_words": n_words,
+        "peak_rss_bytes": get_peak_rss(),
+        "peak_rss_scope": "process",
+    }
+    return [
+        {
+            **shared,
+            "label": "train",
+            "words_per_second": n_words / train_time,
+            "seconds": train_time,
+            "phases": phases,
+        },
+        {
+            **shared,
+            "label": "predict",
+            "words_per_second": n_words / predict_time,
+            "seconds": predict_time,
+            "phases": predict_phases,
+        },
+    ]
+
+
+def format_phases(results: Dict[str, Any]) -> str:
+    """Format the time spent in each phase, and the peak RSS, as a table. Peak
+    RSS values that cover the whole process rather than a single benchmark are
+    marked "(process)".
+    """
+    rows = []
+    for r in results["results"]:
+        phases = ", ".join(
+            f"{phase} {seconds / r['seconds']:.0%}"
+            for phase, seconds in r["phases"].items()
+        )
+        rss = r["peak_rss_bytes"]
+        rss = f"{rss / 2 ** 20:.0f} MB" if rss is not None else "-"
+        if r.get("peak_rss_scope") == "process":
+            rss += " (process)"
+        rows.append((r["name"], r["label"], f"{r['seconds']:.2f} s", phases, rss))
+    header = ("Benchmark", "Variant", "Time", "Phases", "Peak RSS")
+    return table(rows, header=header)
+
+
+def _make_batcher(name: str, model: Model) -> Callable[[List[Ints1d]], Any]:
+    ops = model.ops
+    if name == "sparse_textcat":
+        ngram_ops = get_current_ops()
+
+        def make_batch(docs: List[Ints1d]) -> Any:
+            # Bag of unigrams and hashed bigrams.
+            features = [
+                numpy.concatenate((doc, ngram_ops.ngrams(2, doc))) for doc in docs
+            ]
+            keys = numpy.concatenate(features).astype("uint64")
+            values = numpy.ones((len(keys),), dtype="f")
+            lengths = numpy.asarray([len(f) for f in features], dtype="int32")
+            return (keys, values, lengths)
+
+        return make_batch
+    else:
+        return lambda docs: [ops.asarray(doc) for doc in docs]
+
+
+def _make_truths(
+    model: Model, is_tagger: bool, n_labels: int, tags: List[Ints1d], classes: Ints1d
+) -> Any:
+    if is_tagger:
+        return [model.ops.asarray(_one_hot(t, n_labels)) for t in tags]
+    return model.ops.asarray(_one_hot(classes, n_labels))
+
+
+def _one_hot(labels: Ints1d, n_labels: int) -> numpy.ndarray:
+    output = numpy.zeros((len(labels), n_labels), dtype="f")
+    output[numpy.arange(len(labels)), labels] = 1.0
+    return output
+
+
+def _get_grad(Yh: Any, Y: Any) -> Any:
+    if isinstance(Yh, list):
+        n_words = sum(len(y) for y in Y)
+        return [(yh - y) / n_words for yh, y in zip(Yh, Y)]
+    return (Yh - Y) / len(Y)
+
+
+def get_peak_rss() -> Optional[int]:
+    """Get the peak resident set size of the process in bytes, if available."""
+    if resource is None:  # pragma: no cover
+        return None
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # Linux reports kilobytes, macOS reports bytes.
+    return peak if sys.platform == "darwin" else peak * 1024
@@ -0,0 +1,195 @@
+from typing import Any, Callable, Dict, List, Optional, Tuple
+import platform
+import statistics
+import time
+import numpy
+from wasabi import table
+
+from ..about import __version__
+from ..backends import Ops, NumpyOps, CupyOps, JaxOps, has_cupy, has_jax
+
+
+def get_backends(names: Optional[List[str]] = None) -> List[Ops]:
+    """Get the Ops to benchmark: NumpyOps, plus any other installed backend.
+    Pass a list of names (e.g. ["numpy", "cupy"]) to restrict them.
+    """
+    backends: List[Ops] = [NumpyOps()]
+    if has_cupy:  # pragma: no cover
+        try:
+            backends.append(CupyOps())
+        except Exception:
+            pass
+    if has_jax:  # pragma: no cover
+        backends.append(JaxOps())
+    if names is not None:
+        backends = [ops for ops in backends if ops.name in names]
+    return backends
+
+
+def synchronize(ops: Ops) -> None:
+    """Wait for the kernels queued on the device to finish, so that timings on
+    GPU measure the work and not just the launch.
+    """
+    if isinstance(ops, CupyOps):  # pragma: no cover
+        ops.xp.cuda.get_current_stream().synchronize()
+    elif isinstance(ops, JaxOps):  # pragma: no cover
+        ops.xp.zeros((1,)).block_until_ready()
+
+
+def time_func(
+    ops: Ops, func: Callable[[], Any], *, repeat: int = 5, min_time: float = 0.05
+) -> Dict[str, Any]:
+    """Time a function. After a warm-up call, the number of calls per round
+    is picked so that a round takes at least `min_time` seconds, and
+    `repeat` rounds are timed. Returns the median and minimum seconds per
+    call.
+    """
+    func()
+    synchronize(ops)
+    n_calls = 1
+    while True:
+        start = time.perf_counter()
+        for _ in range(n_calls):
+            func()
+        synchronize(ops)
+        elapsed = time.perf_counter() - start
+        if elapsed >= min_time or n_calls >= 1_000_000:
+            break
+        n_calls *= 2 if elapsed <= 0 else max(2, int(min_time / elapsed) + 1)
+    timings = [elapsed / n_calls]
+    for _ in range(repeat - 1):
+        start = time.perf_counter()
+        for _ in range(n_calls):
+            func()
+        synchronize(ops)
+        timings.append((time.perf_counter() - start) / n_calls)
+    return {
+        "median": statistics.median(timings),
+        "min": min(timings),
+        "n_calls": n_calls,
+        "repeat": len(timings),
+    }
+
+
+def get_metadata() -> Dict[str, Any]:
+    """Describe the environment the benchmarks were run in."""
+    return {
+        "thinc": __version__,
+        "numpy": numpy.__version__,
+        "python": platform.python_version(),
+        "platform": platform.platform(),
+        "machine": platform.machine(),
+        "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
+    }
+
+
+def _get_key(result: Dict[str, Any]) -> Tuple[str, ...]:
+    return (result["suite"], result["backend"], result["name"], result["label"])
+
+
+def compare_results(
+    results: Dict[str, Any],
+    baseline: Dict[str, Any],
+    *,
+    threshold: float = 0.1,
+    metric: str = "median",
+) -> List[Dict[str, Any]]:
+    """Compare benchmark results against a baseline. Each shared benchmark is
+    reported with the ratio of its new and old timings. It is flagged as a
+    regression if the ratio exceeds 1 + threshold. Results can name the
+    value to compare in their "metric" field, and for benchmarks where higher
+    is better (e.g. throughput), the ratio is inverted.
+
+    Benchmarks that have a value in the baseline, but errored or are missing
+    from the current results, are flagged as regressions too, with the status
+    "error" or "missing" instead of "ok".
+    """
+    current = {_get_key(result): result for result in results["results"]}
+    comparison = []
+    for old_result in baseline["results"]:
+        key = _get_key(old_result)
+        result = current.get(key)
+        old_value = old_result.get(old_result.get("metric", metric))
+        if not old_value:
+            continue
+        entry = {
+            "suite": old_result["suite"],
+            "backend": old_result["backend"],
+            "name": old_result["name"],
+            "label": old_result["label"],
+            "baseline": old_value,
+            "current": None,
+            "ratio": None,
+            "unit": old_result.get("unit", "s"),
+        }
+        if result is None:
+            entry.update({"status": "missing", "regression": True})
+        elif not result.get(result.get("metric", metric)):
+            error = result.get("error", "no value")
+            entry.update({"status": "error", "error": error, "regression": True})
+        else:
+            value = result[result.get("metric", metric)]
+            ratio = value / old_value
+            if result.get("higher_is_better"):
+                ratio = 1.0 / ratio
+            entry.update(
+                {
+                    "current": value,
+                    "ratio": ratio,
+                    "status": "ok",
+                    "regression": ratio > 1.0 + threshold,
+                }
+            )
+        comparison.append(entry)
+    return comparison
+
+
+def format_results(results: Dict[str, Any], metric: str = "median") -> str:
+    rows = [
+        (
+            r["backend"],
+            r["name"],
+            r["label"],
+            _format_value(r.get(r.get("metric", metric)), r),
+        )
+        for r in results["results"]
+    ]
+    return table(rows, header=("Backend", "Benchmark", "Variant", "Result"))
+
+
+def format_comparison(comparison: List[Dict[str, Any]]) -> str:
+    rows = [
+        (
+            c["backend"],
+            c["name"],
+            c["label"],
+            _format_value(c["baseline"], c),
+            _format_value(c["current"], c),
+            f"{c['ratio']:.2f}x" if c["ratio"] is not None else "-",
+            _format_status(c),
+        )
+        for c in comparison
+    ]
+    header = ("Backend", "Benchmark", "Variant", "Baseline", "Current", "Ratio", "")
+    return table(rows, header=header)
+
+
+def _format_status(comparison: Dict[str, Any]) -> str:
+    if comparison["status"] == "missing":
+        return "MISSING"
+    elif comparison["status"] == "error":
+        return "ERROR"
+    return "REGRESSION" if comparison["regression"] else ""
+
+
+def _format_value(value: Optional[float], result: Dict[str, Any]) -> str:
+    if value is None:
+        return result.get("error", "-")
+    elif result.get("unit", "s") != "s":
+        return f"{value:,.1f} {result['unit']}"
+    elif value >= 1.0:
+        return f"{value:.3f} s"
+    elif value >= 1e-3:
+        return f"{value * 1e3:.3f} ms"
+    else:
+        return f"{value * 1e6:.1f} us"
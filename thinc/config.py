@@ -149,6 +149,7 @@ class registry(object):
     losses: Decorator = catalogue.create("thinc", "losses", entry_points=True)
     initializers: Decorator = catalogue.create("thinc", "initializers", entry_points=True)
     datasets: Decorator = catalogue.create("thinc", "datasets", entry_points=True)
+    precisions: Decorator = catalogue.create("thinc", "precisions", entry_points=True)
     # fmt: on
 
     @classmethod
@@ -19,6 +19,7 @@ from .sparselinear import SparseLinear
 from .staticvectors import StaticVectors
 from .lstm import LSTM, PyTorchLSTM
 from .tensorflowwrapper import TensorFlowWrapper, keras_subclass
+from .windowedmaxout import WindowedMaxout
 from .mxnetwrapper import MXNetWrapper
 
 # Combinators
@@ -56,6 +57,8 @@ from .with_ragged import with_ragged
 from .with_reshape import with_reshape
 from .with_getitem import with_getitem
 from .with_debug import with_debug
+from .with_checkpoint import with_checkpoint
+from .with_precision import with_precision
 
 
 __all__ = [
@@ -67,6 +70,7 @@ __all__ = [
     "HashEmbed",
     "LayerNorm",
     "Maxout",
+    "WindowedMaxout",
     "Mish",
     "MultiSoftmax",
     "ParametricAttention",
@@ -104,5 +108,7 @@ __all__ = [
     "with_padded",
     "with_flatten",
     "with_debug",
+    "with_checkpoint",
+    "with_precision",
     "remap_ids",
 ]
@@ -1,6 +1,6 @@
 from typing import Tuple, Callable, Optional, TypeVar
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..config import registry
 from ..types import ArrayXd, XY_XY_OutT
 from ..util import get_width
@@ -29,7 +29,15 @@ def add(
 def forward(model: Model[InT, InT], X: InT, is_train: bool) -> Tuple[InT, Callable]:
     if not model.layers:
         return X, lambda dY: dY
+    if NO_GRAD.get():
+        Y = _copy_if_shared(model, X, model.layers[0](X, is_train=is_train)[0])
+        for layer in model.layers[1:]:
+            Y += layer(X, is_train=is_train)[0]
+        return Y, no_backprop
     Y, first_callback = model.layers[0](X, is_train=is_train)
+    # The outputs are summed into the first one, which mustn't be the input
+    # itself, e.g. if the first layer is a noop.
+    Y = _copy_if_shared(model, X, Y)
     callbacks = []
     for layer in model.layers[1:]:
         layer_Y, layer_callback = layer(X, is_train=is_train)
@@ -37,7 +45,7 @@ def forward(model: Model[InT, InT], X: InT, is_train: bool) -> Tuple[InT, Callab
         callbacks.append(layer_callback)
 
     def backprop(dY: InT) -> InT:
-        dX = first_callback(dY)
+        dX = _copy_if_shared(model, dY, first_callback(dY))
         for callback in callbacks:
             dX += callback(dY)
         return dX
@@ -45,6 +53,13 @@ def forward(model: Model[InT, InT], X: InT, is_train: bool) -> Tuple[InT, Callab
     return Y, backprop
 
 
+def _copy_if_shared(model: Model, X: InT, Y: InT) -> InT:
+    may_share_memory = getattr(model.ops.xp, "may_share_memory", None)
+    if Y is X or (may_share_memory is not None and may_share_memory(X, Y)):
+        return Y.copy()
+    return Y
+
+
 def init(
     model: Model[InT, InT], X: Optional[InT] = None, Y: Optional[InT] = None
 ) -> Model[InT, InT]:
@@ -4,6 +4,8 @@ from ..backends import Ops
 from ..model import Model
 from ..config import registry
 from ..types import Padded
+from ..util import partial
+from ..parallel import run_parallel
 
 
 InT = Padded
@@ -12,25 +14,47 @@ OutT = Padded
 
 @registry.layers("bidirectional.v1")
 def bidirectional(
-    l2r: Model[InT, OutT], r2l: Optional[Model[InT, OutT]] = None
+    l2r: Model[InT, OutT],
+    r2l: Optional[Model[InT, OutT]] = None,
+    *,
+    parallel: bool = False,
 ) -> Model[InT, OutT]:
-    """Stitch two RNN models into a bidirectional layer. Expects squared sequences."""
+    """Stitch two RNN models into a bidirectional layer. Expects squared sequences.
+    If `parallel` is True, the two directions are run concurrently on a shared
+    thread pool.
+    """
     if r2l is None:
         r2l = l2r.copy()
-    return Model(f"bi{l2r.name}", forward, layers=[l2r, r2l], init=init)
+    return Model(
+        f"bi{l2r.name}",
+        forward,
+        layers=[l2r, r2l],
+        init=init,
+        attrs={"parallel": parallel},
+    )
 
 
 def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Callable]:
     l2r, r2l = model.layers
     X_rev = _reverse(model.ops, X)
-    l2r_Z, bp_l2r_Z = l2r(X, is_train)
-    r2l_Z, bp_r2l_Z = r2l(X_rev, is_train)
+    if model.attrs.get("parallel"):
+        (l2r_Z, bp_l2r_Z), (r2l_Z, bp_r2l_Z) = run_parallel(
+            [partial(l2r, X, is_train), partial(r2l, X_rev, is_train)]
+        )
+    else:
+        l2r_Z, bp_l2r_Z = l2r(X, is_train)
+        r2l_Z, bp_r2l_Z = r2l(X_rev, is_train)
     Z = _concatenate(model.ops, l2r_Z, r2l_Z)
 
     def backprop(dZ: OutT) -> InT:
         d_l2r_Z, d_r2l_Z = _split(model.ops, dZ)
-        dX_l2r = bp_l2r_Z(d_l2r_Z)
-        dX_r2l = bp_r2l_Z(d_r2l_Z)
+        if model.attrs.get("parallel"):
+            dX_l2r, dX_r2l = run_parallel(
+                [partial(bp_l2r_Z, d_l2r_Z), partial(bp_r2l_Z, d_r2l_Z)]
+            )
+        else:
+            dX_l2r = bp_l2r_Z(d_l2r_Z)
+            dX_r2l = bp_r2l_Z(d_r2l_Z)
         return _sum(dX_l2r, dX_r2l)
 
     return Z, backprop
@@ -1,6 +1,7 @@
 from typing import Tuple, Callable, Optional, TypeVar, Any
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
+from ..model import get_output_buffer, use_output_buffer
 from ..config import registry
 from ..util import get_width
 from ..types import XY_YZ_OutT
@@ -37,13 +38,21 @@ def chain(
 
 def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Callable]:
     """Apply the layers of `model` in sequence, feeding the output from one
-    layer into the next.
+    layer into the next. An output buffer offered to the chain is passed on to
+    its last layer.
     """
+    out = get_output_buffer(model)
+    if NO_GRAD.get():
+        for layer in model.layers[:-1]:
+            X = layer(X, is_train=is_train)[0]
+        return _call_last(model, X, is_train, out)[0], no_backprop
     callbacks = []
-    for layer in model.layers:
+    for layer in model.layers[:-1]:
         Y, inc_layer_grad = layer(X, is_train=is_train)
         callbacks.append(inc_layer_grad)
         X = Y
+    Y, inc_layer_grad = _call_last(model, X, is_train, out)
+    callbacks.append(inc_layer_grad)
 
     def backprop(dY: OutT) -> InT:
         for callback in reversed(callbacks):
@@ -54,6 +63,14 @@ def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Call
     return Y, backprop
 
 
+def _call_last(model: Model, X: Any, is_train: bool, out: Any) -> Tuple[Any, Callable]:
+    layer = model.layers[-1]
+    if out is None:
+        return layer(X, is_train=is_train)
+    with use_output_buffer(layer, out):
+        return layer(X, is_train=is_train)
+
+
 def init(
     model: Model[InT, OutT], X: Optional[InT] = None, Y: Optional[OutT] = None
 ) -> Model[InT, OutT]:
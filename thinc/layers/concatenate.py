@@ -1,10 +1,15 @@
-from typing import Tuple, Callable, Optional, TypeVar, cast
+from typing import Tuple, Callable, Optional, TypeVar, Iterator, Any, cast
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop, use_output_buffer
 from ..config import registry
 from ..types import Array2d
-from ..util import get_width
+from ..util import get_width, partial
+from ..parallel import run_parallel
 from .noop import noop
+from .chain import forward as chain_forward
+from .embed import forward as embed_forward
+from .hashembed import forward as hashembed_forward
+from .linear import forward as linear_forward
 from ..types import XY_XY_OutT
 
 
@@ -13,10 +18,14 @@ OutT = TypeVar("OutT", bound=Array2d)
 
 
 @registry.layers("concatenate.v1")
-def concatenate(*layers: Model) -> Model[InT, XY_XY_OutT]:
+def concatenate(*layers: Model, parallel: bool = False) -> Model[InT, XY_XY_OutT]:
     """Compose two or more models `f`, `g`, etc, such that their outputs are
     concatenated, i.e. `concatenate(f, g)(x)` computes `hstack(f(x), g(x))`.
     Also supports chaining more than 2 layers.
+
+    If `parallel` is True, the branches and their backprop callbacks are run
+    concurrently on a shared thread pool. The branches must not share
+    parameters.
     """
     if not layers:
         return cast(Model[InT, XY_XY_OutT], noop())
@@ -24,6 +33,8 @@ def concatenate(*layers: Model) -> Model[InT, XY_XY_OutT]:
         return layers[0]
     elif layers[0]._func is forward:
         layers[0].layers.extend(layers[1:])
+        if parallel:
+            layers[0].attrs["parallel"] = True
         return layers[0]
 
     return Model(
@@ -32,60 +43,161 @@ def concatenate(*layers: Model) -> Model[InT, XY_XY_OutT]:
         init=init,
         dims={"nO": None, "nI": None},
         layers=layers,
+        attrs={"parallel": parallel},
     )
 
 
 def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Callable]:
-    Ys, callbacks = zip(*[layer(X, is_train=is_train) for layer in model.layers])
+    # If the branch widths are known, allocate the output up front and offer
+    # each branch its column block to write into.
+    output = _alloc_output(model, X)
+    if output is None:
+        blocks = [None] * len(model.layers)
+    else:
+        blocks = _split_columns(output, [layer.get_dim("nO") for layer in model.layers])
+    if model.attrs.get("parallel"):
+        funcs = [
+            partial(_call_branch, layer, X, is_train, out)
+            for layer, out in zip(model.layers, blocks)
+        ]
+        results = run_parallel(funcs)
+    else:
+        results = [
+            _call_branch(layer, X, is_train, out)
+            for layer, out in zip(model.layers, blocks)
+        ]
+    Ys = [Y for Y, _ in results]
+    callbacks = None if NO_GRAD.get() else [callback for _, callback in results]
     if isinstance(Ys[0], list):
         return _list_forward(model, X, Ys, callbacks, is_train)
     else:
-        return _array_forward(model, X, Ys, callbacks, is_train)
+        return _array_forward(model, X, Ys, callbacks, output, blocks)
+
+
+def _call_branch(layer: Model, X, is_train: bool, out) -> Tuple[Any, Callable]:
+    if out is None:
+        return layer(X, is_train=is_train)
+    with use_output_buffer(layer, out):
+        return layer(X, is_train=is_train)
+
+
+def _alloc_output(model: Model[InT, OutT], X) -> Optional[OutT]:
+    if not isinstance(X, model.ops.xp.ndarray) or X.ndim != 2:
+        return None
+    if not all(layer.has_dim("nO") for layer in model.layers):
+        return None
+    width = sum(layer.get_dim("nO") for layer in model.layers)
+    return model.ops.alloc2f(X.shape[0], width)
+
+
+def _split_columns(array, widths):
+    blocks = []
+    start = 0
+    for width in widths:
+        blocks.append(array[:, start : start + width])
+        start += width
+    return blocks
 
 
 def _array_forward(
-    model: Model[InT, OutT], X, Ys, callbacks, is_train: bool
+    model: Model[InT, OutT], X, Ys, callbacks, output, blocks
 ) -> Tuple[OutT, Callable]:
     widths = [Y.shape[1] for Y in Ys]
-    output = model.ops.xp.hstack(Ys)
+    # Branches that support it have written their output into their block
+    # already. Copy the others in, unless a branch returned an output that
+    # doesn't fit the preallocated array.
+    fits = output is not None and all(
+        Y is block or (Y.shape == block.shape and Y.dtype == block.dtype)
+        for Y, block in zip(Ys, blocks)
+    )
+    if not fits:
+        output = model.ops.alloc2f(Ys[0].shape[0], sum(widths), dtype=Ys[0].dtype)
+        blocks = _split_columns(output, widths)
+    for Y, block in zip(Ys, blocks):
+        if Y is not block:
+            block[...] = Y
+    if callbacks is None:
+        return output, no_backprop
+    views_ok = [_keeps_gradient(layer) for layer in model.layers]
 
     def backprop(d_output: OutT) -> InT:
-        dY = model.ops.xp.ascontiguousarray(d_output[:, : widths[0]])
-        dX = callbacks[0](dY)
-        start = widths[0]
-        for bwd, width in zip(callbacks[1:], widths[1:]):
-            dY = model.ops.xp.ascontiguousarray(d_output[:, start : start + width])
-            dX += bwd(dY)
-            start += width
-        return dX
+        # Branches that are known to only read their gradient get a strided
+        # view of their column block. The others may write into it, e.g. with
+        # an in-place activation, so they get their own contiguous copy.
+        dYs = [
+            dY if view_ok else model.ops.xp.ascontiguousarray(dY)
+            for dY, view_ok in zip(_split_columns(d_output, widths), views_ok)
+        ]
+        return _backprop_branches(model, callbacks, dYs, d_output)
 
     return output, backprop
 
 
+def _keeps_gradient(layer: Model) -> bool:
+    """Check whether a layer's backprop is known to leave its output gradient
+    unmodified, and to not return it or a view of it.
+    """
+    while layer._func is chain_forward:
+        layer = layer.layers[-1]
+    return layer._func in (linear_forward, hashembed_forward, embed_forward)
+
+
 def _list_forward(
     model: Model[InT, OutT], X, Ys, callbacks, is_train: bool
 ) -> Tuple[OutT, Callable]:
     lengths = model.ops.asarray1i([len(x) for x in X])
-    Ys = [model.ops.xp.concatenate(Y, axis=0) for Y in Ys]
-    widths = [Y.shape[1] for Y in Ys]
-    output = model.ops.xp.hstack(Ys)
-    output = model.ops.unflatten(output, lengths)
+    widths = [Y[0].shape[1] for Y in Ys]
+    # Write each sequence of each branch straight into the flat output, so
+    # there's only one copy of the data.
+    output = model.ops.alloc2f(int(lengths.sum()), sum(widths), dtype=Ys[0][0].dtype)
+    col = 0
+    for Y, width in zip(Ys, widths):
+        row = 0
+        for Y_i in Y:
+            output[row : row + Y_i.shape[0], col : col + width] = Y_i
+            row += Y_i.shape[0]
+        col += width
+    if callbacks is None:
+        return model.ops.unflatten(output, lengths), no_backprop
 
     def backprop(d_output: OutT) -> InT:
-        d_output = model.ops.xp.concatenate(d_output, axis=0)
-        dY = model.ops.as_contig(d_output[:, : widths[0]])
-        # We want to generalize unflatten later.
-        dY = model.ops.asarray(model.ops.unflatten(dY, lengths))  # type: ignore
-        dX = callbacks[0](dY)
-        start = widths[0]
-        for bwd, width in zip(callbacks[1:], widths[1:]):
-            dY = model.ops.as_contig(d_output[:, start : start + width])
-            dY = model.ops.asarray(model.ops.unflatten(dY, lengths))  # type: ignore
-            dX += bwd(dY)
-            start += width
+        # The flat gradient is our own copy, and the column blocks don't
+        # overlap, so a branch can write into its block without affecting
+        # the others.
+        d_flat = model.ops.xp.concatenate(d_output, axis=0)
+        dYs = [
+            model.ops.unflatten(dY, lengths) for dY in _split_columns(d_flat, widths)
+        ]
+        return _backprop_branches(model, callbacks, dYs, None)
+
+    return model.ops.unflatten(output, lengths), backprop
+
+
+def _backprop_branches(model: Model, callbacks, dYs, d_output) -> Any:
+    if model.attrs.get("parallel"):
+        funcs = [partial(bwd, dY) for bwd, dY in zip(callbacks, dYs)]
+        dXs = iter(run_parallel(funcs))
+    else:
+        dXs = (bwd(dY) for bwd, dY in zip(callbacks, dYs))
+    return _sum_gradients(model, dXs, d_output)
+
+
+def _sum_gradients(model: Model, dXs: Iterator, d_output) -> Any:
+    # The gradients are computed lazily, so only two are alive at a time. The
+    # sum is accumulated into the first one, unless it's a view of the
+    # caller's gradient.
+    dX = next(dXs)
+    if isinstance(dX, list):
+        for dX_i in dXs:
+            for a, b in zip(dX, dX_i):
+                a += b
         return dX
-
-    return output, backprop
+    may_share_memory = getattr(model.ops.xp, "may_share_memory", None)
+    if may_share_memory is not None and may_share_memory(dX, d_output):
+        dX = dX + next(dXs)
+    for dX_i in dXs:
+        dX += dX_i
+    return dX
 
 
 def init(
@@ -1,4 +1,5 @@
 from typing import Tuple, Callable, List, TypeVar, Any
+import numpy
 
 from ..model import Model
 from ..config import registry
@@ -18,6 +19,11 @@ def Dropout(rate: float = 0.0) -> Model[InT, InT]:
     return Model("dropout", forward, attrs={"dropout_rate": rate, "is_enabled": True})
 
 
+def _get_seed() -> int:
+    # Drawn from the global numpy generator, so fix_random_seed applies.
+    return int(numpy.random.randint(0, 2 ** 62))
+
+
 # We're getting type hell here, I think because of the instance checks?
 # It's sort of painful, because I think this confused the types of other
 # layers that are trying to use dropout.
@@ -42,23 +48,24 @@ def _dropout_array(
     model: Model[ArrayT, ArrayT], X: ArrayT, is_train: bool
 ) -> Tuple[ArrayT, Callable]:
     rate = model.attrs["dropout_rate"]
-    mask = model.ops.get_dropout_mask(X.shape, rate)
+    seed = _get_seed()
 
     def backprop(dY: ArrayT) -> ArrayT:
-        return dY * mask
+        return model.ops.backprop_dropout(dY, rate, seed=seed)
 
-    return X * mask, backprop
+    return model.ops.dropout(X, rate, seed=seed), backprop
 
 
 def _dropout_padded(
     model: Model, Xp: Padded, is_train: bool
 ) -> Tuple[Padded, Callable]:
-    X = Xp.data
-    mask = model.ops.get_dropout_mask(X.shape, model.attrs["dropout_rate"])
-    Y = X * mask
+    rate = model.attrs["dropout_rate"]
+    seed = _get_seed()
+    Y = model.ops.dropout(Xp.data, rate, seed=seed)
 
     def backprop(dYp: Padded) -> Padded:
-        return Padded(dYp.data * mask, dYp.size_at_t, dYp.lengths, dYp.indices)
+        dX = model.ops.backprop_dropout(dYp.data, rate, seed=seed)
+        return Padded(dX, dYp.size_at_t, dYp.lengths, dYp.indices)
 
     return Padded(Y, Xp.size_at_t, Xp.lengths, Xp.indices), backprop
 
@@ -66,25 +73,28 @@ def _dropout_padded(
 def _dropout_ragged(
     model: Model, Xr: Ragged, is_train: bool
 ) -> Tuple[Ragged, Callable]:
-    X = Xr.data
-    lengths = Xr.lengths
-    mask = model.ops.get_dropout_mask(X.shape, model.attrs["dropout_rate"])
-    Y = X * mask
+    rate = model.attrs["dropout_rate"]
+    seed = _get_seed()
+    Y = model.ops.dropout(Xr.data, rate, seed=seed)
 
     def backprop(dYr: Ragged) -> Ragged:
-        return Ragged(dYr.data * mask, dYr.lengths)
+        dX = model.ops.backprop_dropout(dYr.data, rate, seed=seed)
+        return Ragged(dX, dYr.lengths)
 
-    return Ragged(Y, lengths), backprop
+    return Ragged(Y, Xr.lengths), backprop
 
 
 def _dropout_lists(
     model: Model[ArrayT, ArrayT], Xs: List[ArrayT], is_train: bool
 ) -> Tuple[List[ArrayT], Callable]:
     rate = model.attrs["dropout_rate"]
-    masks = [model.ops.get_dropout_mask(X.shape, rate) for X in Xs]
-    Ys = [X * mask for X, mask in zip(Xs, masks)]
+    seeds = [_get_seed() for _ in Xs]
+    Ys = [model.ops.dropout(X, rate, seed=seed) for X, seed in zip(Xs, seeds)]
 
     def backprop(dYs: List[ArrayT]) -> List[ArrayT]:
-        return [dY * mask for dY, mask in zip(dYs, masks)]
+        return [
+            model.ops.backprop_dropout(dY, rate, seed=seed)
+            for dY, seed in zip(dYs, seeds)
+        ]
 
     return Ys, backprop
@@ -2,7 +2,7 @@ from typing import Dict, Callable, Tuple, Optional, Union, cast
 
 from .chain import chain
 from .array_getitem import ints_getitem
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..config import registry
 from ..types import Ints1d, Ints2d, Floats1d, Floats2d
 from ..initializers import uniform_init
@@ -54,9 +54,11 @@ def forward(
     output = vectors[ids]
     drop_mask = cast(Floats1d, model.ops.get_dropout_mask((nO,), dropout))
     output *= drop_mask
+    if NO_GRAD.get():
+        return output, no_backprop
 
     def backprop(d_output: OutT) -> Ints1d:
-        d_output *= drop_mask
+        d_output = d_output * drop_mask
         d_vectors = model.ops.alloc2f(*vectors.shape)
         model.ops.scatter_add(d_vectors, ids, d_output)
         model.inc_grad("E", d_vectors)
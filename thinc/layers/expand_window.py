@@ -1,27 +1,51 @@
-from typing import Tuple, Callable
+from typing import Tuple, TypeVar, Callable, cast
 
 from ..model import Model
 from ..config import registry
-from ..types import Floats2d
+from ..types import Floats2d, Ragged
 
 
-InT = Floats2d
-OutT = Floats2d
+InT = TypeVar("InT", Floats2d, Ragged)
 
 
 @registry.layers("expand_window.v1")
-def expand_window(window_size: int = 1) -> Model[InT, OutT]:
+def expand_window(window_size: int = 1) -> Model[InT, InT]:
     """For each vector in an input, construct an output vector that contains the
     input and a window of surrounding vectors. This is one step in a convolution.
+    If the input is Ragged, the windows don't reach across the boundaries of its
+    sequences, so a batch doesn't need to be padded.
     """
     return Model("expand_window", forward, attrs={"window_size": window_size})
 
 
-def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Callable]:
+def forward(model: Model[InT, InT], X: InT, is_train: bool) -> Tuple[InT, Callable]:
+    if isinstance(X, Ragged):
+        return _expand_window_ragged(model, X)
+    else:
+        return _expand_window_floats(model, X)
+
+
+def _expand_window_floats(
+    model: Model[InT, InT], X: Floats2d
+) -> Tuple[Floats2d, Callable]:
     nW = model.attrs["window_size"]
     Y = model.ops.seq2col(X, nW)
 
-    def backprop(dY: OutT) -> InT:
-        return model.ops.backprop_seq2col(dY, nW)
+    def backprop(dY: Floats2d) -> Floats2d:
+        return model.ops.backprop_seq2col(model.ops.as_contig(dY), nW)
 
     return Y, backprop
+
+
+def _expand_window_ragged(
+    model: Model[InT, InT], Xr: Ragged
+) -> Tuple[Ragged, Callable]:
+    nW = model.attrs["window_size"]
+    Y = model.ops.seq2col(cast(Floats2d, Xr.data), nW, lengths=Xr.lengths)
+
+    def backprop(dYr: Ragged) -> Ragged:
+        dY = model.ops.as_contig(cast(Floats2d, dYr.data))
+        dX = model.ops.backprop_seq2col(dY, nW, lengths=Xr.lengths)
+        return Ragged(dX, Xr.lengths)
+
+    return Ragged(Y, Xr.lengths), backprop
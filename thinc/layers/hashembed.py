@@ -2,7 +2,7 @@ from typing import Callable, Dict, Tuple, Optional, Any, Union, cast
 
 from .chain import chain
 from .array_getitem import ints_getitem
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop, get_output_buffer
 from ..config import registry
 from ..types import Floats1d, Floats2d, Ints2d, Ints1d
 from ..initializers import uniform_init
@@ -57,13 +57,15 @@ def forward(
     nN = ids.shape[0]
     seed: int = model.attrs["seed"]
     keys = model.ops.hash(ids, seed) % nV
+    output = vectors[keys].sum(axis=1, out=get_output_buffer(model))
     dropout: Optional[float] = model.attrs.get("dropout_rate")
     drop_mask = cast(Floats1d, model.ops.get_dropout_mask((nO,), dropout))
-    output = vectors[keys].sum(axis=1)
     output *= drop_mask
+    if NO_GRAD.get():
+        return output, no_backprop
 
     def backprop(d_vectors: OutT) -> Ints1d:
-        d_vectors *= drop_mask
+        d_vectors = d_vectors * drop_mask
         dE = model.ops.alloc2f(*vectors.shape)
         keysT = model.ops.as_contig(keys.T, dtype="i")
         for i in range(keysT.shape[0]):
@@ -1,7 +1,10 @@
 from typing import Tuple, Callable, Optional, cast
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop, get_output_buffer
 from ..config import registry
+from ..quantization import forward_int8, backprop_int8
+from ..precision import get_current_precision, forward_compressed, save_input
+from ..pruning import forward_sparse
 from ..types import Floats1d, Floats2d
 from ..initializers import glorot_uniform_init, zero_init
 from ..util import get_width, partial
@@ -30,14 +33,26 @@ def Linear(
 
 
 def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Callable]:
+    if model.has_param("W_int8"):
+        return forward_int8(model, X), backprop_int8
+    if model.has_param("W_indptr"):
+        return forward_sparse(model, X)
+    precision = get_current_precision()
+    if NO_GRAD.get() and precision.params != "float32":
+        return forward_compressed(model, X, precision.params), no_backprop
     W = cast(Floats2d, model.get_param("W"))
     b = cast(Floats1d, model.get_param("b"))
-    Y = model.ops.gemm(X, W, trans2=True)
+    # A parent such as concatenate may hand us a zeroed block of its own
+    # output to write into.
+    Y = model.ops.gemm(X, W, trans2=True, out=get_output_buffer(model))
     Y += b
+    if NO_GRAD.get():
+        return Y, no_backprop
+    get_X = save_input(model, X, precision.activations)
 
     def backprop(dY: OutT) -> InT:
         model.inc_grad("b", dY.sum(axis=0))
-        model.inc_grad("W", model.ops.gemm(dY, X, trans1=True))
+        model.inc_grad("W", model.ops.gemm(dY, get_X(), trans1=True))
         return model.ops.gemm(dY, W)
 
     return Y, backprop
@@ -1,6 +1,6 @@
 from typing import Tuple, Callable
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..config import registry
 from ..types import Floats2d
 
@@ -16,6 +16,8 @@ def Logistic() -> Model[InT, OutT]:
 
 def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Callable]:
     Y = model.ops.sigmoid(X, inplace=False)
+    if NO_GRAD.get():
+        return Y, no_backprop
 
     def backprop(dY: OutT) -> InT:
         return dY * model.ops.dsigmoid(Y, inplace=False)
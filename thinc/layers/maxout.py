@@ -1,7 +1,10 @@
 from typing import Tuple, Callable, Optional, cast
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..config import registry
+from ..quantization import forward_int8, backprop_int8
+from ..precision import get_current_precision, forward_compressed, save_input
+from ..pruning import forward_sparse
 from ..initializers import glorot_uniform_init, zero_init
 from ..types import Floats2d
 from ..util import get_width, partial
@@ -42,27 +45,52 @@ def Maxout(
 def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Callable]:
     nO = model.get_dim("nO")
     nP = model.get_dim("nP")
-    nI = model.get_dim("nI")
-    b = model.get_param("b")
-    W = model.get_param("W")
-    W = model.ops.reshape2f(W, nO * nP, nI)
-    Y = model.ops.gemm(X, W, trans2=True)
-    Y += model.ops.reshape1f(b, nO * nP)
+    if model.has_param("W_int8"):
+        Y = forward_int8(model, X)
+        best, _ = model.ops.maxout(model.ops.reshape3f(Y, Y.shape[0], nO, nP))
+        return best, backprop_int8
+    if model.has_param("W_indptr"):
+        Y, backprop_affine = forward_sparse(model, X)
+    else:
+        Y, backprop_affine = _forward_dense(model, X)
     Z = model.ops.reshape3f(Y, Y.shape[0], nO, nP)
     best, which = model.ops.maxout(Z)
+    if NO_GRAD.get():
+        return best, no_backprop
 
     def backprop(d_best: OutT) -> InT:
-        dZ = model.ops.backprop_maxout(d_best, which, nP)
-        # TODO: Add sum methods for Floats3d
-        model.inc_grad("b", dZ.sum(axis=0))  # type: ignore
+        dZ = model.ops.backprop_maxout(model.ops.as_contig(d_best), which, nP)
         dY = model.ops.reshape2f(dZ, dZ.shape[0], nO * nP)
-        dX = model.ops.reshape3f(model.ops.gemm(dY, X, trans1=True), nO, nP, nI)
-        model.inc_grad("W", dX)
-        return model.ops.gemm(dY, model.ops.reshape2f(W, nO * nP, nI))
+        return backprop_affine(dY)
 
     return best, backprop
 
 
+def _forward_dense(model: Model[InT, OutT], X: InT) -> Tuple[Floats2d, Callable]:
+    nO = model.get_dim("nO")
+    nP = model.get_dim("nP")
+    nI = model.get_dim("nI")
+    precision = get_current_precision()
+    if NO_GRAD.get() and precision.params != "float32":
+        return forward_compressed(model, X, precision.params), no_backprop
+    b = model.get_param("b")
+    W = model.ops.reshape2f(model.get_param("W"), nO * nP, nI)
+    Y = model.ops.gemm(X, W, trans2=True)
+    Y += model.ops.reshape1f(b, nO * nP)
+    if NO_GRAD.get():
+        return Y, no_backprop
+    get_X = save_input(model, X, precision.activations)
+
+    def backprop(dY: Floats2d) -> InT:
+        model.inc_grad("b", model.ops.reshape2f(dY.sum(axis=0), nO, nP))
+        dW = model.ops.gemm(dY, get_X(), trans1=True)
+        dW = model.ops.reshape3f(dW, nO, nP, nI)
+        model.inc_grad("W", dW)
+        return model.ops.gemm(dY, W)
+
+    return Y, backprop
+
+
 def init(
     init_W: Callable,
     init_b: Callable,
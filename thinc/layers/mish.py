@@ -1,6 +1,6 @@
 from typing import Tuple, Callable, Optional, cast
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..initializers import glorot_uniform_init, zero_init
 from ..config import registry
 from ..types import Floats1d, Floats2d
@@ -47,9 +47,11 @@ def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Call
     Y_pre_mish = model.ops.gemm(X, W, trans2=True)
     Y_pre_mish += b
     Y = model.ops.mish(Y_pre_mish)
+    if NO_GRAD.get():
+        return Y, no_backprop
 
     def backprop(dY: OutT) -> InT:
-        dY_pre_mish = model.ops.backprop_mish(dY, Y_pre_mish)
+        dY_pre_mish = model.ops.backprop_mish(model.ops.as_contig(dY), Y_pre_mish)
         model.inc_grad("W", model.ops.gemm(dY_pre_mish, X, trans1=True))
         model.inc_grad("b", dY_pre_mish.sum(axis=0))
         dX = model.ops.gemm(dY_pre_mish, W)
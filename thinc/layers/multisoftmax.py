@@ -1,8 +1,10 @@
 from typing import Optional, Tuple, Callable, cast
 
 from ..types import Floats2d, Floats1d
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..config import registry
+from ..quantization import forward_int8, backprop_int8
+from ..precision import get_current_precision, forward_compressed, save_input
 from ..util import get_width
 
 
@@ -29,21 +31,37 @@ def MultiSoftmax(nOs: Tuple[int, ...], nI: Optional[int] = None) -> Model[InT, O
 
 def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Callable]:
     nOs = model.attrs["nOs"]
+    if model.has_param("W_int8"):
+        Y = forward_int8(model, X)
+        _softmax_slices(model, Y, nOs)
+        return Y, backprop_int8
+    precision = get_current_precision()
+    if NO_GRAD.get() and precision.params != "float32":
+        Y = forward_compressed(model, X, precision.params)
+        _softmax_slices(model, Y, nOs)
+        return Y, no_backprop
     W = cast(Floats2d, model.get_param("W"))
     b = cast(Floats1d, model.get_param("b"))
+    Y = model.ops.gemm(X, W, trans2=True)
+    Y += b
+    _softmax_slices(model, Y, nOs)
+    if NO_GRAD.get():
+        return Y, no_backprop
+    get_X = save_input(model, X, precision.activations)
 
     def backprop(dY: OutT) -> InT:
-        model.inc_grad("W", model.ops.gemm(dY, X, trans1=True))
+        model.inc_grad("W", model.ops.gemm(dY, get_X(), trans1=True))
         model.inc_grad("b", dY.sum(axis=0))
         return model.ops.gemm(dY, W)
 
-    Y = model.ops.gemm(X, W)
-    Y += b
+    return Y, backprop
+
+
+def _softmax_slices(model: Model[InT, OutT], Y: OutT, nOs: Tuple[int, ...]) -> None:
     i = 0
     for out_size in nOs:
         model.ops.softmax(Y[:, i : i + out_size], inplace=True)
         i += out_size
-    return Y, backprop
 
 
 def init(
@@ -1,6 +1,6 @@
 from typing import Tuple, Callable, Optional
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..config import registry
 from ..types import Ragged
 from ..util import get_width
@@ -18,14 +18,17 @@ def ParametricAttention(nO: Optional[int] = None) -> Model[InT, OutT]:
 
 def forward(model: Model[InT, OutT], Xr: InT, is_train: bool) -> Tuple[OutT, Callable]:
     Q = model.get_param("Q")
-    attention, bp_attention = _get_attention(model.ops, Q, Xr.data, Xr.lengths)
-    output, bp_output = _apply_attention(model.ops, attention, Xr.data, Xr.lengths)
+    X = model.ops.as_contig(Xr.data)
+    output, attention = model.ops.parametric_attention(X, Q, Xr.lengths)
+    if NO_GRAD.get():
+        return Ragged(output, Xr.lengths), no_backprop
 
     def backprop(dYr: OutT) -> InT:
-        dX, d_attention = bp_output(dYr.data)
-        dQ, dX2 = bp_attention(d_attention)
-        model.inc_grad("Q", dQ.ravel())
-        dX += dX2
+        dY = model.ops.as_contig(dYr.data)
+        dX, dQ = model.ops.backprop_parametric_attention(
+            dY, X, Q, attention, Xr.lengths
+        )
+        model.inc_grad("Q", dQ)
         return Ragged(dX, dYr.lengths)
 
     return Ragged(output, Xr.lengths), backprop
@@ -38,27 +41,3 @@ def init(
         model.set_dim("nO", get_width(Y.data))
     model.set_param("Q", model.ops.alloc1f(model.get_dim("nO")))
     return model
-
-
-def _get_attention(ops, Q, X, lengths):
-    attention = ops.gemm(X, ops.reshape2f(Q, -1, 1))
-    attention = ops.softmax_sequences(attention, lengths)
-
-    def get_attention_bwd(d_attention):
-        d_attention = ops.backprop_softmax_sequences(d_attention, attention, lengths)
-        dQ = ops.gemm(X, d_attention, trans1=True)
-        dX = ops.xp.outer(d_attention, Q)
-        return dQ, dX
-
-    return attention, get_attention_bwd
-
-
-def _apply_attention(self, attention, X, lengths):
-    output = X * attention
-
-    def apply_attention_bwd(d_output):
-        d_attention = (X * d_output).sum(axis=1, keepdims=True)
-        dX = d_output * attention
-        return dX, d_attention
-
-    return output, apply_attention_bwd
@@ -19,6 +19,7 @@ def forward(model: Model[InT, OutT], Xr: InT, is_train: bool) -> Tuple[OutT, Cal
     lengths = Xr.lengths
 
     def backprop(dY: OutT) -> InT:
+        dY = model.ops.as_contig(dY)
         return Ragged(model.ops.backprop_reduce_mean(dY, lengths), lengths)
 
     return Y, backprop
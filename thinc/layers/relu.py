@@ -1,6 +1,6 @@
 from typing import Tuple, Callable, Optional, cast
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..initializers import glorot_uniform_init, zero_init
 from ..config import registry
 from ..types import Floats2d, Floats1d
@@ -42,6 +42,8 @@ def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Call
     W = cast(Floats2d, model.get_param("W"))
     b = cast(Floats1d, model.get_param("b"))
     Y = model.ops.affine(X, W, b)
+    if NO_GRAD.get():
+        return model.ops.relu(Y, inplace=True), no_backprop
     Y = model.ops.relu(Y)
 
     def backprop(dY: OutT) -> InT:
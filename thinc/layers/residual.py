@@ -1,6 +1,6 @@
 from typing import Tuple, Callable, Optional, List, TypeVar
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..config import registry
 from ..types import Floats1d, Floats2d, Floats3d, Floats4d, FloatsXd, Ragged, Padded
 
@@ -38,6 +38,8 @@ def forward(model: Model[InT, InT], X: InT, is_train: bool) -> Tuple[InT, Callab
             return d_output + dX
 
     Y, backprop_layer = model.layers[0](X, is_train)
+    if NO_GRAD.get():
+        backprop = no_backprop
     if isinstance(X, list):
         return [X[i] + Y[i] for i in range(len(X))], backprop
     elif isinstance(X, Ragged):
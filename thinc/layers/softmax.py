@@ -1,7 +1,9 @@
 from typing import Tuple, Callable, Optional, cast
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..config import registry
+from ..quantization import forward_int8, backprop_int8
+from ..precision import get_current_precision, forward_compressed, save_input
 from ..types import Floats2d, Floats1d
 from ..initializers import zero_init
 from ..util import get_width, partial
@@ -17,31 +19,57 @@ def Softmax(
     nI: Optional[int] = None,
     *,
     init_W: Callable = zero_init,
-    init_b: Callable = zero_init
+    init_b: Callable = zero_init,
+    normalize_outputs: bool = True,
 ) -> Model[InT, OutT]:
+    """A dense layer followed by a softmax. With normalize_outputs=False, the
+    layer outputs the unnormalized logits while training, to be used with a
+    loss that applies the softmax itself, such as
+    CategoricalCrossentropy(from_logits=True). It still outputs probabilities
+    during prediction.
+    """
     return Model(
         "softmax",
         forward,
         init=partial(init, init_W, init_b),
         dims={"nO": nO, "nI": nI},
         params={"W": None, "b": None},
+        attrs={"normalize_outputs": normalize_outputs},
     )
 
 
 def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Callable]:
+    # The training forward may run under no_grad() too, e.g. in with_checkpoint,
+    # so every path has to respect normalize_outputs.
+    normalize = not is_train or model.attrs["normalize_outputs"]
+    if model.has_param("W_int8"):
+        Y = forward_int8(model, X)
+        return _normalize(model, Y, normalize), backprop_int8
+    precision = get_current_precision()
+    if NO_GRAD.get() and precision.params != "float32":
+        Y = forward_compressed(model, X, precision.params)
+        return _normalize(model, Y, normalize), no_backprop
     W = cast(Floats2d, model.get_param("W"))
     b = cast(Floats1d, model.get_param("b"))
     Y = model.ops.affine(X, W, b)
-    Y = model.ops.softmax(Y)
+    if NO_GRAD.get():
+        return _normalize(model, Y, normalize), no_backprop
+    if normalize:
+        Y = model.ops.softmax(Y)
+    get_X = save_input(model, X, precision.activations)
 
     def backprop(dY: InT) -> OutT:
         model.inc_grad("b", dY.sum(axis=0))
-        model.inc_grad("W", model.ops.gemm(dY, X, trans1=True))
+        model.inc_grad("W", model.ops.gemm(dY, get_X(), trans1=True))
         return model.ops.gemm(dY, W)
 
     return Y, backprop
 
 
+def _normalize(model: Model[InT, OutT], Y: OutT, normalize: bool) -> OutT:
+    return model.ops.softmax(Y, inplace=True) if normalize else Y
+
+
 def init(
     init_W: Callable,
     init_b: Callable,
@@ -6,7 +6,7 @@ from thinc.util import partial, get_width
 from .chain import chain
 from .array_getitem import ints_getitem
 from ..types import Ints1d, Floats2d, Ints2d, Floats1d, Unserializable
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..config import registry
 from contextvars import ContextVar
 
@@ -26,6 +26,11 @@ def StaticVectors(
     dropout: Optional[float] = None,
     init_W: Callable = glorot_uniform_init,
 ) -> Model[InT, OutT]:
+    """Project a static table of vectors with a trainable weights matrix. At
+    inference, the projection of each row of the table is computed the first
+    time the row is used and cached, so the output is gathered from the
+    cached projections.
+    """
     attrs: Dict[str, Any] = {"column": column, "vectors": Unserializable(vectors)}
     if dropout is not None:
         attrs["dropout_rate"] = dropout
@@ -54,7 +59,14 @@ def forward(
     vectors = cast(Floats2d, model.attrs["vectors"].obj)
     W = cast(Floats2d, model.get_param("W"))
     nN = ids.shape[0]
-    vectors = vectors[ids * (ids < vectors.shape[0])]
+    rows = ids * (ids < vectors.shape[0])
+    dropout: Optional[float] = model.attrs.get("dropout_rate")
+    if NO_GRAD.get() and not is_train:
+        output = _get_projected(model, vectors, W, rows)
+        drop_mask = model.ops.get_dropout_mask((output.shape[1],), dropout)
+        output *= drop_mask
+        return output, no_backprop
+    vectors = vectors[rows]
     vectors = model.ops.as_contig(vectors)
     assert vectors.shape[0] == ids.shape[0]
 
@@ -64,12 +76,48 @@ def forward(
         return dX
 
     output = model.ops.gemm(vectors, W, trans2=True)
-    dropout: Optional[float] = model.attrs.get("dropout_rate")
     drop_mask = cast(Floats1d, model.ops.get_dropout_mask((output.shape[1],), dropout))
     output *= drop_mask
     return output, backprop
 
 
+def _get_projected(
+    model: Model[InT, OutT], vectors: Floats2d, W: Floats2d, rows: Ints1d
+) -> OutT:
+    """Gather the projections of the rows from the cache, projecting the rows
+    that weren't seen before. The projections are stored in the order the
+    rows are first seen, so the cache only grows with the rows that are used.
+    It's dropped when W is set or the vectors are replaced.
+    """
+    cache = model.get_packed_param("W", _new_cache)
+    if cache.get("vectors") is not vectors:
+        cache["vectors"] = vectors
+        # The index of each row's projection in the table, or -1.
+        cache["slots"] = model.ops.xp.full((vectors.shape[0],), -1, dtype="int32")
+        cache["table"] = model.ops.alloc2f(0, W.shape[0])
+        cache["size"] = 0
+    slots = cache["slots"]
+    new_rows = rows[slots[rows] < 0]
+    if new_rows.size:
+        new_rows = model.ops.xp.unique(new_rows)
+        start = cache["size"]
+        end = start + new_rows.shape[0]
+        table = cache["table"]
+        if end > table.shape[0]:
+            grown = model.ops.alloc2f(max(end, table.shape[0] * 2), W.shape[0])
+            grown[:start] = table[:start]
+            table = cache["table"] = grown
+        new_vectors = model.ops.as_contig(vectors[new_rows])
+        table[start:end] = model.ops.gemm(new_vectors, W, trans2=True)
+        slots[new_rows] = model.ops.xp.arange(start, end, dtype="int32")
+        cache["size"] = end
+    return cache["table"][slots[rows]]
+
+
+def _new_cache(W: Floats2d) -> Dict[str, Any]:
+    return {}
+
+
 def init(
     init_W: Callable,
     model: Model[InT, OutT],
@@ -1,9 +1,9 @@
-from typing import Tuple, Callable, Optional
+from typing import Tuple, Callable, Optional, Dict, Any
 import numpy
 
-from ..model import Model
+from ..model import Model, NO_GRAD, no_backprop
 from ..config import registry
-from ..types import Ints2d, Floats2d
+from ..types import Ints1d, Ints2d, Floats2d, ArrayXd
 
 
 InT = Ints2d
@@ -11,19 +11,28 @@ OutT = Floats2d
 
 
 @registry.layers("uniqued.v1")
-def uniqued(layer: Model, *, column: int = 0) -> Model[InT, OutT]:
+def uniqued(
+    layer: Model, *, column: int = 0, cache_size: int = 0
+) -> Model[InT, OutT]:
     """Group inputs to a layer, so that the layer only has to compute for the
     unique values. The data is transformed back before output, and the same
     transformation is applied for the gradient. Effectively, this is a cache
     local to each minibatch.
+
+    If `cache_size` is set, the outputs for up to that many keys are also kept
+    across batches at inference, i.e. when the model is called under
+    `no_grad()` with `is_train=False`, evicting the least recently used keys.
+    The cache is cleared whenever a parameter of the wrapped layer is set,
+    e.g. by the optimizer.
     """
+    cache = _OutputCache(cache_size) if cache_size >= 1 else None
     return Model(
         f"uniqued-{layer.name}",
         forward,
         init=init,
         layers=[layer],
         dims={"nO": None, "nI": None},
-        attrs={"column": column},
+        attrs={"column": column, "cache": cache},
     )
 
 
@@ -32,21 +41,23 @@ def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Call
     layer = model.layers[0]
     if X.size < 2:
         return layer(X, is_train)
-    keys = X[:, column]
-    if not isinstance(keys, numpy.ndarray):
-        keys = keys.get()  # pragma: no cover
-    uniq_keys, ind, inv, counts = layer.ops.xp.unique(
-        keys, return_index=True, return_inverse=True, return_counts=True
-    )
-    counts = model.ops.reshape2i(counts, -1, 1)
+    ind, inv, counts = model.ops.unique_keys(X[:, column])
+    cache: Optional[_OutputCache] = model.attrs["cache"]
+    if cache is not None and NO_GRAD.get() and not is_train:
+        Y_uniq = _get_cached_outputs(layer, X, ind, column, cache)
+        Y = Y_uniq[inv].reshape((X.shape[0],) + Y_uniq.shape[1:])
+        return Y, no_backprop
     X_uniq = X[ind]
     Y_uniq, bp_Y_uniq = layer(X_uniq, is_train)
     Y = Y_uniq[inv].reshape((X.shape[0],) + Y_uniq.shape[1:])
+    if NO_GRAD.get():
+        return Y, no_backprop
+    counts = model.ops.reshape2i(counts, -1, 1)
     uniq_shape = tuple(Y_uniq.shape)
 
     def backprop(dY: OutT) -> InT:
         dY_uniq = layer.ops.alloc2f(*uniq_shape)
-        layer.ops.scatter_add(dY_uniq, layer.ops.asarray_i(inv), dY)
+        layer.ops.scatter_add(dY_uniq, inv, dY)
         d_uniques = bp_Y_uniq(dY_uniq)
         # This confusing bit of indexing "ununiques"
         return (d_uniques / counts)[inv]
@@ -54,6 +65,95 @@ def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Call
     return Y, backprop
 
 
+def _get_cached_outputs(
+    layer: Model, X: InT, ind: Ints1d, column: int, cache: "_OutputCache"
+) -> OutT:
+    keys = numpy.asarray(layer.ops.to_numpy(X[ind, column]), dtype="uint64")
+    slots = cache.lookup(keys, _get_param_versions(layer))
+    miss = numpy.nonzero(slots < 0)[0]
+    if not miss.size:
+        return cache.table[layer.ops.asarray1i(slots)]
+    Y_miss, _ = layer(X[ind[layer.ops.asarray1i(miss)]], is_train=False)
+    Y_uniq = layer.ops.alloc((len(keys),) + Y_miss.shape[1:], dtype=Y_miss.dtype)
+    Y_uniq[layer.ops.asarray1i(miss)] = Y_miss
+    hit = numpy.nonzero(slots >= 0)[0]
+    if hit.size:
+        hit_slots = layer.ops.asarray1i(slots[hit])
+        Y_uniq[layer.ops.asarray1i(hit)] = cache.table[hit_slots]
+    # Add the new keys after the hits are read, as they may evict them.
+    cache.add(layer.ops, keys[miss], Y_miss)
+    return Y_uniq
+
+
+def _get_param_versions(layer: Model) -> Tuple[Tuple[int, int], ...]:
+    # Only the wrapped layer's own parameters invalidate the cache, so other
+    # models training or loading in the same process don't clear it.
+    _, slots = layer._get_index()
+    return tuple(
+        (id(node._params), node._params.get_version(node.id, name))
+        for node, name in slots
+    )
+
+
+class _OutputCache:
+    """A bounded table of the output rows of a layer, by key. Once it's full,
+    the keys that were least recently used are evicted first.
+    """
+
+    def __init__(self, size: int):
+        self.size = size
+        self.clear()
+
+    def clear(self) -> None:
+        self.slots: Dict[int, int] = {}
+        self.keys = numpy.zeros((self.size,), dtype="uint64")
+        self.last_used = numpy.zeros((self.size,), dtype="int64")
+        self.table: Optional[ArrayXd] = None
+        self.n_batches = 0
+        self.version: Any = None
+
+    def lookup(self, keys: numpy.ndarray, version: Any) -> numpy.ndarray:
+        """Get the slot of each key in the table, or -1 if it's missing. The
+        table is cleared first if the layer's parameters have changed since it
+        was filled, as given by their `version`.
+        """
+        if version != self.version:
+            self.clear()
+            self.version = version
+        self.n_batches += 1
+        get_slot = self.slots.get
+        slots = numpy.fromiter(
+            (get_slot(key, -1) for key in keys.tolist()), dtype="int64", count=len(keys)
+        )
+        self.last_used[slots[slots >= 0]] = self.n_batches
+        return slots
+
+    def add(self, ops, keys: numpy.ndarray, rows: ArrayXd) -> None:
+        """Add the output rows of keys that are missing from the table."""
+        keys = keys[: self.size]
+        rows = rows[: self.size]
+        if self.table is not None and self.table.shape[1:] != rows.shape[1:]:
+            self.clear()
+        if self.table is None:
+            self.table = ops.alloc((self.size,) + rows.shape[1:], dtype=rows.dtype)
+        n_used = len(self.slots)
+        n_free = self.size - n_used
+        if len(keys) <= n_free:
+            slots = numpy.arange(n_used, n_used + len(keys))
+        else:
+            # Keys that were used in this batch have the newest stamps, so
+            # they're evicted last.
+            n_evict = len(keys) - n_free
+            lru = numpy.argpartition(self.last_used[:n_used], n_evict - 1)[:n_evict]
+            for key in self.keys[lru].tolist():
+                del self.slots[key]
+            slots = numpy.concatenate((numpy.arange(n_used, self.size), lru))
+        self.keys[slots] = keys
+        self.last_used[slots] = self.n_batches
+        self.slots.update(zip(keys.tolist(), slots.tolist()))
+        self.table[ops.asarray1i(slots)] = rows
+
+
 def init(
     model: Model[InT, OutT], X: Optional[InT] = None, Y: Optional[OutT] = None
 ) -> Model[InT, OutT]:
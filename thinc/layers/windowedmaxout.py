@@ -0,0 +1,114 @@
+from typing import Tuple, Callable, Optional, TypeVar, cast
+
+from ..model import Model, NO_GRAD, no_backprop
+from ..config import registry
+from ..initializers import glorot_uniform_init, zero_init
+from ..types import Floats2d, Floats3d, Ints1d, Ragged
+from ..backends import Ops
+from ..util import get_width, partial
+from .dropout import Dropout
+from .layernorm import LayerNorm
+from .with_array import with_array
+from .chain import chain
+
+
+InT = TypeVar("InT", Floats2d, Ragged)
+
+
+@registry.layers("WindowedMaxout.v1")
+def WindowedMaxout(
+    nO: Optional[int] = None,
+    nI: Optional[int] = None,
+    nP: Optional[int] = 3,
+    *,
+    window_size: int = 1,
+    init_W: Callable = glorot_uniform_init,
+    init_b: Callable = zero_init,
+    dropout: Optional[float] = None,
+    normalize: bool = False,
+) -> Model[InT, InT]:
+    """A convolutional maxout layer, equivalent to
+    `chain(expand_window(window_size), Maxout(nO, nI * (window_size * 2 + 1)))`
+    but without materializing the window matrix, in either the forward or the
+    backward pass. The weights have the same shape as the Maxout weights, so
+    the two can be swapped. If the input is Ragged, the windows don't reach
+    across the boundaries of its sequences.
+    """
+    model: Model[InT, InT] = Model(
+        "windowed_maxout",
+        forward,
+        init=partial(init, init_W, init_b),
+        dims={"nO": nO, "nI": nI, "nP": nP},
+        params={"W": None, "b": None},
+        attrs={"window_size": window_size},
+    )
+    if normalize:
+        model = chain(model, with_array(LayerNorm(nI=nO)))
+    if dropout is not None:
+        model = chain(model, cast(Model[InT, InT], Dropout(dropout)))
+    return model
+
+
+def forward(model: Model[InT, InT], X: InT, is_train: bool) -> Tuple[InT, Callable]:
+    if isinstance(X, Ragged):
+        Y, backprop = _forward_array(model, cast(Floats2d, X.data), X.lengths)
+        lengths = X.lengths
+        return (
+            Ragged(Y, lengths),
+            lambda dYr: Ragged(backprop(cast(Floats2d, dYr.data)), lengths),
+        )
+    else:
+        return _forward_array(model, X, None)
+
+
+def _forward_array(
+    model: Model[InT, InT], X: Floats2d, lengths: Optional[Ints1d]
+) -> Tuple[Floats2d, Callable]:
+    nO = model.get_dim("nO")
+    nP = model.get_dim("nP")
+    nI = model.get_dim("nI")
+    nW = model.attrs["window_size"]
+    nF = nW * 2 + 1
+    b = model.get_param("b")
+    W = model.get_packed_param("W", partial(_pack_weights, model.ops, nW))
+    Y = model.ops.window_gemm(X, W, nW, lengths=lengths)
+    Y += model.ops.reshape1f(b, nO * nP)
+    Z = model.ops.reshape3f(Y, Y.shape[0], nO, nP)
+    best, which = model.ops.maxout(Z)
+    if NO_GRAD.get():
+        return best, no_backprop
+
+    def backprop(d_best: Floats2d) -> Floats2d:
+        dZ = model.ops.backprop_maxout(model.ops.as_contig(d_best), which, nP)
+        # TODO: Add sum methods for Floats3d
+        model.inc_grad("b", dZ.sum(axis=0))  # type: ignore
+        dY = model.ops.reshape2f(dZ, dZ.shape[0], nO * nP)
+        dX, dW = model.ops.backprop_window_gemm(dY, X, W, nW, lengths=lengths)
+        model.inc_grad("W", model.ops.reshape3f(dW, nO, nP, nF * nI))
+        return dX
+
+    return best, backprop
+
+
+def _pack_weights(ops: Ops, nW: int, W: Floats3d) -> Floats3d:
+    W2 = ops.reshape2f(W, W.shape[0] * W.shape[1], W.shape[2])
+    return ops.pack_window_weights(W2, nW)
+
+
+def init(
+    init_W: Callable,
+    init_b: Callable,
+    model: Model[InT, InT],
+    X: Optional[InT] = None,
+    Y: Optional[InT] = None,
+) -> Model[InT, InT]:
+    if X is not None:
+        model.set_dim("nI", get_width(X))
+    if Y is not None:
+        model.set_dim("nO", get_width(Y))
+    nF = model.attrs["window_size"] * 2 + 1
+    nO = model.get_dim("nO")
+    nP = model.get_dim("nP")
+    model.set_param("W", init_W(model.ops, (nO, nP, nF * model.get_dim("nI"))))
+    model.set_param("b", init_b(model.ops, (nO, nP)))
+    return model
@@ -0,0 +1,75 @@
+from typing import Tuple, Callable, Optional, TypeVar, Any
+import copy
+import numpy
+
+from ..model import Model, NO_GRAD, no_grad
+from ..config import registry
+from ..backends import Ops
+
+
+InT = TypeVar("InT")
+OutT = TypeVar("OutT")
+
+
+@registry.layers("with_checkpoint.v1")
+def with_checkpoint(layer: Model[InT, OutT]) -> Model[InT, OutT]:
+    """Trade compute for memory by discarding the activations of the wrapped
+    layer after the forward pass, and recomputing them when the backward pass
+    is called. Only the input is kept alive in between. The random states of
+    numpy and of the ops' array module are saved before the forward pass and
+    replayed during the recomputation, so layers like Dropout produce the same
+    masks both times.
+    """
+    return Model(f"with_checkpoint-{layer.name}", forward, init=init, layers=[layer])
+
+
+def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Callable]:
+    layer = model.layers[0]
+    if not is_train or NO_GRAD.get():
+        return layer(X, is_train=is_train)
+    rng_state = _get_rng_state(model.ops)
+    with no_grad():
+        Y, _ = layer(X, is_train=is_train)
+
+    def backprop(dY: OutT) -> InT:
+        current_state = _get_rng_state(model.ops)
+        _set_rng_state(model.ops, rng_state)
+        _, get_dX = layer(X, is_train=is_train)
+        _set_rng_state(model.ops, current_state)
+        return get_dX(dY)
+
+    return Y, backprop
+
+
+def init(
+    model: Model[InT, OutT], X: Optional[InT] = None, Y: Optional[OutT] = None
+) -> Model[InT, OutT]:
+    model.layers[0].initialize(X=X, Y=Y)
+    return model
+
+
+def _get_rng_state(ops: Ops) -> Any:
+    # Layers like Dropout draw their seeds from the global numpy generator,
+    # whatever the ops, so save it alongside the generator of ops.xp.
+    random = getattr(ops.xp, "random", None)
+    if random is None or random is numpy.random:
+        xp_state = None
+    elif hasattr(random, "get_state"):
+        xp_state = random.get_state()
+    elif hasattr(random, "get_random_state"):  # pragma: no cover
+        xp_state = copy.deepcopy(random.get_random_state())
+    else:  # pragma: no cover
+        xp_state = None
+    return numpy.random.get_state(), xp_state
+
+
+def _set_rng_state(ops: Ops, state: Any) -> None:
+    numpy_state, xp_state = state
+    numpy.random.set_state(numpy_state)
+    random = getattr(ops.xp, "random", None)
+    if xp_state is None:
+        return
+    elif hasattr(random, "set_state"):
+        random.set_state(xp_state)
+    else:  # pragma: no cover
+        random.set_random_state(xp_state)
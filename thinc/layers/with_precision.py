@@ -0,0 +1,62 @@
+from typing import Tuple, Callable, Optional, TypeVar
+
+from ..model import Model
+from ..config import registry
+from ..precision import Precision, use_precision
+
+
+InT = TypeVar("InT")
+OutT = TypeVar("OutT")
+
+
+@registry.layers("with_precision.v1")
+def with_precision(layer: Model[InT, OutT], precision: Precision) -> Model[InT, OutT]:
+    """Run the wrapped layer under a mixed-precision policy, for both the
+    forward and the backward pass. This lets the policy be set from a config,
+    e.g. with a block of the "precisions" registry, instead of calling
+    `set_current_precision` in code.
+
+    EXAMPLE:
+        [model]
+        @layers = "with_precision.v1"
+
+        [model.precision]
+        @precisions = "mixed_precision.v1"
+        params = "bfloat16"
+        activations = "bfloat16"
+
+        [model.layer]
+        ...
+    """
+    return Model(
+        f"with_precision-{layer.name}",
+        forward,
+        init=init,
+        layers=[layer],
+        attrs={
+            "precision_params": precision.params,
+            "precision_activations": precision.activations,
+        },
+    )
+
+
+def forward(model: Model[InT, OutT], X: InT, is_train: bool) -> Tuple[OutT, Callable]:
+    precision = Precision(
+        params=model.attrs["precision_params"],
+        activations=model.attrs["precision_activations"],
+    )
+    with use_precision(precision):
+        Y, backprop_layer = model.layers[0](X, is_train=is_train)
+
+    def backprop(dY: OutT) -> InT:
+        with use_precision(precision):
+            return backprop_layer(dY)
+
+    return Y, backprop
+
+
+def init(
+    model: Model[InT, OutT], X: Optional[InT] = None, Y: Optional[OutT] = None
+) -> Model[InT, OutT]:
+    model.layers[0].initialize(X=X, Y=Y)
+    return model
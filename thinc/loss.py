@@ -1,6 +1,8 @@
-from typing import Tuple, List, cast, TypeVar, Generic, Any, Union
+from typing import Tuple, List, Optional, cast, TypeVar, Generic, Any, Union
+import numpy
 
-from .types import Floats2d, Ints1d
+from .backends import Ops, NumpyOps, CupyOps, JaxOps, get_current_ops
+from .types import Floats1d, Floats2d, Ints1d, Ragged
 from .util import get_array_module, to_categorical
 from .config import registry
 
@@ -32,81 +34,189 @@ class Loss(Generic[GuessT, TruthT, GradT, LossT]):  # pragma: no cover
 
 
 class CategoricalCrossentropy(Loss):
-    def __init__(self, *, normalize: bool = True):
+    """The categorical cross-entropy loss. The truths can be one-hot (or
+    other target distribution) rows, or integer class labels, which are used
+    directly without building a one-hot matrix.
+
+    By default the guesses are probabilities, e.g. the outputs of a Softmax
+    layer, and the loss is the sum of the squared gradients. With
+    from_logits=True, the guesses are unnormalized scores, e.g. from
+    Softmax(normalize_outputs=False). The softmax, the gradient and the loss
+    are then computed in one fused op, and the loss is the actual
+    cross-entropy.
+    """
+
+    def __init__(self, *, normalize: bool = True, from_logits: bool = False):
         self.normalize = normalize
+        self.from_logits = from_logits
 
     def __call__(
         self, guesses: Floats2d, truths: Union[Ints1d, Floats2d]
     ) -> Tuple[Floats2d, float]:
-        return self.get_grad(guesses, truths), self.get_loss(guesses, truths)
+        d_guesses, losses = self._get_grad_and_losses(guesses, truths)
+        return d_guesses, float(losses.sum())
 
     def get_grad(self, guesses: Floats2d, truths: Union[Ints1d, Floats2d]) -> Floats2d:
-        if truths.ndim != guesses.ndim:
-            # transform categorical values to one-hot encoding
-            target = to_categorical(cast(Ints1d, truths), n_classes=guesses.shape[-1])
-        else:  # pragma: no cover
-            target = cast(Floats2d, truths)
-        if guesses.shape != target.shape:  # pragma: no cover
-            err = f"Cannot calculate CategoricalCrossentropy loss: mismatched shapes: {guesses.shape} vs {target.shape}."
-            raise ValueError(err)
-        if guesses.any() > 1 or guesses.any() < 0:  # pragma: no cover
-            err = f"Cannot calculate CategoricalCrossentropy loss with guesses outside the [0,1] interval."
-            raise ValueError(err)
-        if target.any() > 1 or target.any() < 0:  # pragma: no cover
-            err = f"Cannot calculate CategoricalCrossentropy loss with truth values outside the [0,1] interval."
-            raise ValueError(err)
-        difference = guesses - target
-        if self.normalize:
-            difference = difference / guesses.shape[0]
-        return difference
+        return self._get_grad_and_losses(guesses, truths)[0]
 
     def get_loss(self, guesses: Floats2d, truths: Union[Ints1d, Floats2d]) -> float:
-        d_truth = self.get_grad(guesses, truths)
+        return float(self._get_grad_and_losses(guesses, truths)[1].sum())
+
+    def _get_grad_and_losses(
+        self,
+        guesses: Floats2d,
+        truths: Union[Ints1d, Floats2d],
+        scale: Optional[Union[float, Floats1d]] = None,
+    ) -> Tuple[Floats2d, Floats1d]:
+        """Get the gradient and the loss of each row. The gradient is divided
+        by the number of rows if normalize is set, or by `scale` if given.
+        """
+        if scale is None and self.normalize:
+            scale = 1.0 / max(guesses.shape[0], 1)
+        if self.from_logits:
+            d_guesses, losses = self._get_logits_grad(guesses, truths)
+            if scale is not None:
+                d_guesses *= _as_column(scale)
+                losses *= scale
+            return d_guesses, losses
+        if truths.ndim != guesses.ndim:
+            labels = cast(Ints1d, truths)
+            if labels.shape[0] != guesses.shape[0]:
+                err = f"Cannot calculate CategoricalCrossentropy loss: mismatched shapes: {guesses.shape} vs {labels.shape}."
+                raise ValueError(err)
+            # Subtract the one-hot targets in place, instead of building them.
+            difference = guesses.copy()
+            difference[get_array_module(guesses).arange(guesses.shape[0]), labels] -= 1
+        else:
+            target = cast(Floats2d, truths)
+            if guesses.shape != target.shape:  # pragma: no cover
+                err = f"Cannot calculate CategoricalCrossentropy loss: mismatched shapes: {guesses.shape} vs {target.shape}."
+                raise ValueError(err)
+            if guesses.any() > 1 or guesses.any() < 0:  # pragma: no cover
+                err = f"Cannot calculate CategoricalCrossentropy loss with guesses outside the [0,1] interval."
+                raise ValueError(err)
+            if target.any() > 1 or target.any() < 0:  # pragma: no cover
+                err = f"Cannot calculate CategoricalCrossentropy loss with truth values outside the [0,1] interval."
+                raise ValueError(err)
+            difference = guesses - target
+        if scale is not None:
+            difference = difference * _as_column(scale)
         # TODO: Add overload for axis=None case to sum
-        return (d_truth ** 2).sum()  # type: ignore
+        return difference, (difference ** 2).sum(axis=1)  # type: ignore
+
+    def _get_logits_grad(
+        self, logits: Floats2d, truths: Union[Ints1d, Floats2d]
+    ) -> Tuple[Floats2d, Floats1d]:
+        ops = _get_ops(logits)
+        if truths.ndim != logits.ndim:
+            return ops.softmax_cross_entropy(ops.asarray2f(logits), truths)
+        target = cast(Floats2d, truths)
+        if logits.shape != target.shape:  # pragma: no cover
+            err = f"Cannot calculate CategoricalCrossentropy loss: mismatched shapes: {logits.shape} vs {target.shape}."
+            raise ValueError(err)
+        probs = ops.softmax(logits)
+        log_probs = ops.xp.log(ops.xp.maximum(probs, 1e-30))
+        return probs - target, -(target * log_probs).sum(axis=1)
 
 
 @registry.losses("CategoricalCrossentropy.v1")
 def configure_CategoricalCrossentropy(
-    *, normalize: bool = True
+    *, normalize: bool = True, from_logits: bool = False
 ) -> CategoricalCrossentropy:
-    return CategoricalCrossentropy(normalize=normalize)
+    return CategoricalCrossentropy(normalize=normalize, from_logits=from_logits)
 
 
 class SequenceCategoricalCrossentropy(Loss):
-    def __init__(self, *, normalize: bool = True):
-        self.cc = CategoricalCrossentropy(normalize=normalize)
+    """The categorical cross-entropy of a batch of sequences, given either as
+    a list of arrays or as a Ragged array, with the truths as a list of
+    per-sequence labels or rows, or as a single array for the whole batch.
+    The batch is concatenated and scored in one pass rather than sequence by
+    sequence. With normalize=True, each sequence is normalized by its own
+    length. The gradients have the same structure as the guesses.
+    """
+
+    def __init__(self, *, normalize: bool = True, from_logits: bool = False):
+        self.cc = CategoricalCrossentropy(normalize=False, from_logits=from_logits)
+        self.normalize = normalize
 
     def __call__(
-        self, guesses: List[Floats2d], truths: List[Union[Ints1d, Floats2d]]
-    ) -> Tuple[List[Floats2d], List[float]]:
-        return self.get_grad(guesses, truths), self.get_loss(guesses, truths)
+        self,
+        guesses: Union[List[Floats2d], Ragged],
+        truths: Union[List[Union[Ints1d, Floats2d]], Ints1d, Floats2d],
+    ) -> Tuple[Union[List[Floats2d], Ragged], List[float]]:
+        d_scores, losses = self._get_grad_and_losses(guesses, truths)
+        return d_scores, losses
 
     def get_grad(
-        self, guesses: List[Floats2d], truths: List[Union[Ints1d, Floats2d]]
-    ) -> List[Floats2d]:
-        err = "Cannot calculate SequenceCategoricalCrossentropy loss: guesses and truths must be same length"
-        if len(guesses) != len(truths):  # pragma: no cover
-            raise ValueError(err)
-        d_scores = []
-        for yh, y in zip(guesses, truths):
-            d_scores.append(self.cc.get_grad(yh, y))
-        return d_scores
+        self,
+        guesses: Union[List[Floats2d], Ragged],
+        truths: Union[List[Union[Ints1d, Floats2d]], Ints1d, Floats2d],
+    ) -> Union[List[Floats2d], Ragged]:
+        return self._get_grad_and_losses(guesses, truths)[0]
 
     def get_loss(
-        self, guesses: List[Floats2d], truths: List[Union[Ints1d, Floats2d]]
+        self,
+        guesses: Union[List[Floats2d], Ragged],
+        truths: Union[List[Union[Ints1d, Floats2d]], Ints1d, Floats2d],
     ) -> List[float]:
+        return self._get_grad_and_losses(guesses, truths)[1]
+
+    def _get_grad_and_losses(
+        self,
+        guesses: Union[List[Floats2d], Ragged],
+        truths: Union[List[Union[Ints1d, Floats2d]], Ints1d, Floats2d],
+    ) -> Tuple[Union[List[Floats2d], Ragged], List[float]]:
+        if isinstance(guesses, Ragged):
+            data = cast(Floats2d, guesses.dataXd)
+            lengths = numpy.asarray(_get_ops(data).to_numpy(guesses.lengths))
+        else:
+            if isinstance(truths, (list, tuple)) and len(guesses) != len(truths):
+                err = "Cannot calculate SequenceCategoricalCrossentropy loss: guesses and truths must be same length"
+                raise ValueError(err)
+            if not guesses:
+                return [], []
+            if len(set(yh.shape[-1] for yh in guesses)) != 1:
+                # The sequences can't be concatenated, so score them one by one.
+                return self._get_grad_and_losses_by_sequence(guesses, truths)
+            xp = get_array_module(guesses[0])
+            data = xp.concatenate(guesses)
+            lengths = numpy.asarray([len(yh) for yh in guesses], dtype="i")
+        flat_truths = _concatenate_truths(truths, data.shape[-1])
+        scale = None
+        if self.normalize:
+            xp = get_array_module(data)
+            scale = xp.asarray(numpy.repeat(1.0 / numpy.maximum(lengths, 1), lengths))
+            scale = scale.astype(data.dtype)
+        d_data, row_losses = self.cc._get_grad_and_losses(data, flat_truths, scale)
+        ends = numpy.cumsum(lengths)
+        cumulative = numpy.concatenate(
+            ([0.0], numpy.cumsum(_get_ops(data).to_numpy(row_losses), dtype="float64"))
+        )
+        losses = [float(loss) for loss in cumulative[ends] - cumulative[ends - lengths]]
+        if isinstance(guesses, Ragged):
+            return Ragged(d_data, guesses.lengths), losses
+        return get_array_module(d_data).split(d_data, ends[:-1]), losses
+
+    def _get_grad_and_losses_by_sequence(
+        self, guesses: List[Floats2d], truths: List[Union[Ints1d, Floats2d]]
+    ) -> Tuple[List[Floats2d], List[float]]:
+        d_scores = []
         losses = []
         for yh, y in zip(guesses, truths):
-            losses.append(self.cc.get_loss(yh, y))
-        return losses
+            scale = 1.0 / max(yh.shape[0], 1) if self.normalize else None
+            d_yh, row_losses = self.cc._get_grad_and_losses(yh, y, scale)
+            d_scores.append(d_yh)
+            losses.append(float(row_losses.sum()))
+        return d_scores, losses
 
 
 @registry.losses("SequenceCategoricalCrossentropy.v1")
 def configure_SequenceCategoricalCrossentropy(
-    *, normalize: bool = True
+    *, normalize: bool = True, from_logits: bool = False
 ) -> SequenceCategoricalCrossentropy:
-    return SequenceCategoricalCrossentropy(normalize=normalize)
+    return SequenceCategoricalCrossentropy(
+        normalize=normalize, from_logits=from_logits
+    )
 
 
 class L2Distance(Loss):
@@ -213,6 +323,45 @@ def configure_CosineDistance(
     return CosineDistance(normalize=normalize, ignore_zeros=ignore_zeros)
 
 
+def _get_ops(array: Any) -> Ops:
+    # Prefer the current ops, so e.g. JaxOps arrays don't reach the NumpyOps
+    # kernels, and fall back to the backend the array belongs to.
+    xp = get_array_module(array)
+    ops = get_current_ops()
+    if ops.xp is xp:
+        return ops
+    for ops_class in (NumpyOps, CupyOps, JaxOps):
+        if ops_class.xp is xp:
+            return ops_class()
+    return ops
+
+
+def _as_column(scale: Union[float, Floats1d]) -> Union[float, Floats2d]:
+    return scale.reshape((-1, 1)) if hasattr(scale, "reshape") else scale
+
+
+def _concatenate_truths(
+    truths: Union[List[Union[Ints1d, Floats2d]], Ints1d, Floats2d], n_classes: int
+) -> Union[Ints1d, Floats2d]:
+    """Concatenate per-sequence truths into one array for the whole batch.
+    Integer labels stay integer labels, unless the sequences mix labels and
+    rows, in which case the labels are converted to one-hot rows.
+    """
+    if not isinstance(truths, (list, tuple)):
+        return truths
+    if not truths:
+        return numpy.zeros((0,), dtype="i")
+    xp = get_array_module(truths[0])
+    if all(y.ndim == 1 for y in truths):
+        return xp.concatenate(truths)
+    return xp.concatenate(
+        [
+            to_categorical(y, n_classes=n_classes) if y.ndim == 1 else y
+            for y in truths
+        ]
+    )
+
+
 __all__ = [
     "SequenceCategoricalCrossentropy",
     "CategoricalCrossentropy",
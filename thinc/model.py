@@ -9,11 +9,12 @@ import functools
 import threading
 
 from .backends import ParamServer, Ops, NumpyOps, CupyOps, get_current_ops
+from .backends import _memory
 from .optimizers import Optimizer  # noqa: F401
 from .shims import Shim
 from .util import convert_recursive, is_xp_array
 from .util import partial, validate_fwd_input_output
-from .types import FloatsXd
+from .types import ArrayXd, FloatsXd
 
 
 InT = TypeVar("InT")
@@ -22,12 +23,101 @@ SelfT = TypeVar("SelfT", bound="Model")
 
 context_operators: ContextVar[dict] = ContextVar("context_operators", default={})
 DATA_VALIDATION: ContextVar[bool] = ContextVar("DATA_VALIDATION", default=True)
+NO_GRAD: ContextVar[bool] = ContextVar("NO_GRAD", default=False)
 
 
 def empty_init(model: "Model", *args, **kwargs) -> "Model":
     return model
 
 
+@contextlib.contextmanager
+def no_grad():
+    """Run forward passes in inference mode for the scope of the block. Layers
+    check the NO_GRAD flag to skip building their backprop callbacks, so no
+    activations are kept alive for a backward pass that will never happen.
+
+    EXAMPLE:
+        with no_grad():
+            Y, _ = model(X, is_train=False)
+    """
+    token = NO_GRAD.set(True)
+    try:
+        yield
+    finally:
+        NO_GRAD.reset(token)
+
+
+def no_backprop(dY: Any) -> Any:
+    """Callback returned by forward passes run under `no_grad()`."""
+    raise ValueError("Cannot backprop: the forward pass was run under no_grad()")
+
+
+# The ID of the layer that's been offered an output buffer, and the buffer.
+OUTPUT_BUFFER: ContextVar[Optional[Tuple[int, Any]]] = ContextVar(
+    "OUTPUT_BUFFER", default=None
+)
+
+
+@contextlib.contextmanager
+def use_output_buffer(model: "Model", out: Any):
+    """Offer `model` a zeroed array to write its output into, for the scope of
+    the block. Layers that support it, e.g. Linear, return the buffer as their
+    output, so the caller doesn't have to copy it. Other layers ignore it.
+    """
+    token = OUTPUT_BUFFER.set((model.id, out))
+    try:
+        yield
+    finally:
+        OUTPUT_BUFFER.reset(token)
+
+
+def get_output_buffer(model: "Model") -> Optional[Any]:
+    """Get the array offered to `model` by `use_output_buffer`, if any."""
+    offer = OUTPUT_BUFFER.get()
+    if offer is None or offer[0] != model.id:
+        return None
+    return offer[1]
+
+
+# Bumped whenever the structure of any model changes: layers are added or
+# removed, or a node registers a new parameter name. Models compare it against
+# the version their cached node and parameter index was built at.
+_structure_version: int = 0
+
+
+def _structure_changed() -> None:
+    global _structure_version
+    _structure_version += 1
+
+
+class _LayerList(list):
+    """A list of child layers that invalidates the cached parameter index of
+    every model when it's modified.
+    """
+
+    def _wrap(method):  # type: ignore
+        @functools.wraps(method)
+        def modify(self, *args, **kwargs):
+            _structure_changed()
+            return method(self, *args, **kwargs)
+
+        return modify
+
+    append = _wrap(list.append)
+    extend = _wrap(list.extend)
+    insert = _wrap(list.insert)
+    remove = _wrap(list.remove)
+    pop = _wrap(list.pop)
+    clear = _wrap(list.clear)
+    sort = _wrap(list.sort)
+    reverse = _wrap(list.reverse)
+    __setitem__ = _wrap(list.__setitem__)
+    __delitem__ = _wrap(list.__delitem__)
+    __iadd__ = _wrap(list.__iadd__)
+    __imul__ = _wrap(list.__imul__)
+    del _wrap
+
+
 class Model(Generic[InT, OutT]):
     """Class for implementing Thinc models and layers."""
 
@@ -42,10 +132,11 @@ class Model(Generic[InT, OutT]):
     _init: Callable
     _params: ParamServer
     _dims: Dict[str, Optional[int]]
-    _layers: List["Model"]
+    _layer_list: List["Model"]
     _shims: List[Shim]
     _attrs: Dict[str, Any]
     _has_params: Dict[str, Optional[bool]]
+    _index: Optional[Tuple[int, List["Model"], List[Tuple["Model", str]]]]
 
     # This "locks" the class, so we get an error if you try to assign to
     # an unexpected variable.
@@ -59,9 +150,10 @@ class Model(Generic[InT, OutT]):
         "_dims",
         "_attrs",
         "_refs",
-        "_layers",
+        "_layer_list",
         "_shims",
         "_has_params",
+        "_index",
     ]
 
     def __init__(
@@ -90,7 +182,7 @@ class Model(Generic[InT, OutT]):
         self._dims = dict(dims)
         self._attrs = dict(attrs)
         self._refs = dict(refs)
-        self._layers = list(layers)
+        self._layers = layers
         self._shims = list(shims)
         # Take care to increment the base class here! It needs to be unique
         # across all models.
@@ -98,17 +190,38 @@ class Model(Generic[InT, OutT]):
             Model.global_id += 1
         self.id = Model.global_id
         self._has_params = {}
+        self._index = None
         for name, value in params.items():
             self._has_params[name] = None
             if value is not None:
                 self.set_param(name, value)
 
+    def __getstate__(self) -> Dict[str, Any]:
+        # The cached index is checked against a counter that's global to the
+        # process, so it's dropped when the model is pickled or deep-copied.
+        state = {name: getattr(self, name) for name in self.__slots__}
+        state["_index"] = None
+        return state
+
+    def __setstate__(self, state: Dict[str, Any]) -> None:
+        for name, value in state.items():
+            setattr(self, name, value)
+
     @property
     def layers(self) -> List["Model"]:
         """A list of child layers of the model. You can append to it to add
         layers but not reassign it.
         """
-        return self._layers
+        return self._layer_list
+
+    @property
+    def _layers(self) -> List["Model"]:
+        return self._layer_list
+
+    @_layers.setter
+    def _layers(self, layers: Iterable["Model"]) -> None:
+        _structure_changed()
+        self._layer_list = _LayerList(layers)
 
     @property
     def shims(self) -> List[Shim]:
@@ -211,12 +324,24 @@ class Model(Generic[InT, OutT]):
 
     def set_param(self, name: str, value: Optional[FloatsXd]) -> None:
         """Set a weights parameter's value."""
+        if name not in self._has_params:
+            _structure_changed()
         if value is None:
             self._has_params[name] = None
         else:
             self._params.set_param(self.id, name, value)
             self._has_params[name] = True
 
+    def get_packed_param(self, name: str, pack: Callable[[FloatsXd], Any]) -> Any:
+        """Retrieve a weights parameter converted by the `pack` function, e.g.
+        into the layout an op computes with. The result is cached until the
+        parameter is set, e.g. by `finish_update`, so repeated calls don't
+        repack the weights. If you modify the parameter in place, set it again
+        afterwards, so that the cached result is rebuilt.
+        """
+        self.get_param(name)
+        return self._params.get_packed_param(self.id, name, pack)
+
     def has_grad(self, name: str) -> bool:
         """Check whether the model has a non-zero gradient for a parameter.
         """
@@ -268,7 +393,12 @@ class Model(Generic[InT, OutT]):
     def __call__(self, X: InT, is_train: bool) -> Tuple[OutT, Callable]:
         """Call the model's `forward` function, returning the output and a
         callback to compute the gradients via backpropagation."""
-        return self._func(self, X, is_train=is_train)
+        tracker = _memory.active_tracker
+        if tracker is None:
+            return self._func(self, X, is_train=is_train)
+        # The tracker maintains the node stack that allocations are
+        # attributed to.
+        return tracker.call(self, X, is_train=is_train)
 
     def initialize(self, X: Optional[InT] = None, Y: Optional[OutT] = None) -> "Model":
         """Finish initialization of the model, optionally providing a batch of
@@ -286,26 +416,42 @@ class Model(Generic[InT, OutT]):
         takes the gradient with respect to the output and an optimizer function,
         and returns the gradient with respect to the input.
         """
-        return self._func(self, X, is_train=True)
+        return self(X, is_train=True)
 
     def predict(self, X: InT) -> OutT:
         """Call the model's `forward` function with `is_train=False`, and return
-        only the output, instead of the `(output, callback)` tuple.
+        only the output, instead of the `(output, callback)` tuple. The forward
+        pass is run under `no_grad()`, so layers don't keep state around for the
+        backward pass.
         """
-        return self._func(self, X, is_train=False)[0]
+        with no_grad():
+            return self(X, is_train=False)[0]
 
-    def finish_update(self, optimizer: Optimizer) -> None:
+    def finish_update(self, optimizer: Optimizer, *, n_accumulated: int = 1) -> None:
         """Update parameters with current gradients. The optimizer is called
-        with each parameter and gradient of the model.
+        with each parameter and gradient of the model. The gradient buffers
+        are zeroed in place and kept, so they're reused by the next batch.
+
+        Gradients from several micro-batches can be accumulated by calling
+        their backprop callbacks before a single call to `finish_update`.
+        Pass the number of micro-batches as `n_accumulated` to update with
+        their mean gradient.
         """
-        for node in self.walk():
-            for name in node.param_names:
-                if node.has_grad(name):
-                    param = node.get_param(name)
-                    grad = node.get_grad(name)
-                    param, grad = optimizer((node.id, name), param, grad)
-                    node.set_param(name, param)
-                    node.set_grad(name, grad)
+        if n_accumulated < 1:
+            raise ValueError(f"Invalid number of accumulated batches: {n_accumulated}")
+        nodes, slots = self._get_index()
+        for node, name in slots:
+            if node.has_grad(name):
+                # The optimizer may update the parameter in place.
+                node._params.unshare(node.id, name)
+                param = node.get_param(name)
+                grad = node.get_grad(name)
+                if n_accumulated != 1:
+                    grad *= 1.0 / n_accumulated
+                param, grad = optimizer((node.id, name), param, grad)
+                node.set_param(name, param)
+                node.set_grad(name, grad)
+        for node in nodes:
             for shim in node.shims:
                 shim.finish_update(optimizer)
 
@@ -315,33 +461,46 @@ class Model(Generic[InT, OutT]):
         specified values. The params are a dictionary keyed by model IDs, whose
         values are arrays of weight values.
         """
-        backup = {}
-        for name in self.param_names:
-            key = (self.id, name)
+        nodes, slots = self._get_index()
+        backup = []
+        for node, name in slots:
+            key = (node.id, name)
             if key in params:
-                backup[name] = self.get_param(name)
-                self.set_param(name, params[key])
+                backup.append((node, name, node.get_param(name)))
+                node.set_param(name, params[key])
 
         with contextlib.ExitStack() as stack:
-            for layer in self.layers:
-                stack.enter_context(layer.use_params(params))
-            for shim in self.shims:
-                stack.enter_context(shim.use_params(params))
+            for node in nodes:
+                for shim in node.shims:
+                    stack.enter_context(shim.use_params(params))
             yield
-        if backup:
-            for name, param in backup.items():
-                self.set_param(name, param)
+        for node, name, param in backup:
+            node.set_param(name, param)
 
     def walk(self) -> Iterable["Model"]:
         """Iterate out layers of the model, breadth-first."""
+        return iter(self._get_index()[0])
+
+    def _get_index(self) -> Tuple[List["Model"], List[Tuple["Model", str]]]:
+        """Get the nodes of the tree in breadth-first order, and a flat list of
+        (node, param_name) slots. The index is cached, and only rebuilt after
+        the structure of a model changes.
+        """
+        if self._index is not None and self._index[0] == _structure_version:
+            return self._index[1], self._index[2]
+        version = _structure_version
         queue = [self]
         seen: Set[int] = set()
+        nodes = []
         for node in queue:
             if id(node) in seen:
                 continue
             seen.add(id(node))
-            yield node
+            nodes.append(node)
             queue.extend(node.layers)
+        slots = [(node, name) for node in nodes for name in node.param_names]
+        self._index = (version, nodes, slots)
+        return nodes, slots
 
     def remove_node(self, node: "Model") -> None:
         """Remove a node from all layers lists, and then update references.
@@ -365,38 +524,52 @@ class Model(Generic[InT, OutT]):
         keyed by the parameter ID. The values are (weights, gradients) tuples.
         """
         gradients = {}
-        for node in self.walk():
-            for name in node.grad_names:
+        for node, name in self._get_index()[1]:
+            if node.has_grad(name):
+                # The optimizer may update the parameter in place.
+                node._params.unshare(node.id, name)
                 param = node.get_param(name)
                 grad = node.get_grad(name)
                 gradients[(node.id, name)] = (param, grad)
         return gradients
 
-    def copy(self: SelfT) -> SelfT:
+    def copy(self: SelfT, *, share_params: bool = False) -> SelfT:
         """
         Create a copy of the model, its attributes, and its parameters. Any child
         layers will also be deep-copied. The copy will receive a distinct `model.id`
         value.
+
+        If `share_params` is True, the copy is a lightweight replica: it
+        shares read-only parameter buffers with the original instead of
+        copying them, and a parameter is only copied once either model sets
+        it or receives a gradient for it. Gradients aren't copied, and the dims
+        and attrs are still deep-copied, so e.g. dropout rates stay separate.
         """
         params = {}
-        grads = {}
         for name in self.param_names:
             params[name] = self.get_param(name) if self.has_param(name) else None
-        for name in self.grad_names:
-            grads[name] = self.get_grad(name)
 
         copied: Model[InT, OutT] = Model(
             self.name,
             self._func,
             init=self._init,
-            params=copy.deepcopy(params),
+            params={name: None for name in params}
+            if share_params
+            else copy.deepcopy(params),
             dims=copy.deepcopy(self._dims),
             attrs=copy.deepcopy(self._attrs),
-            layers=[layer.copy() for layer in self.layers],
+            layers=[layer.copy(share_params=share_params) for layer in self.layers],
             shims=[shim.copy() for shim in self.shims],
         )
-        for name in self.grad_names:
-            copied.set_grad(name, self.get_grad(name).copy())
+        if share_params:
+            for name, value in params.items():
+                if value is not None:
+                    self._params.share_param(self.id, name, value)
+                    copied._params.share_param(copied.id, name, value)
+                    copied._has_params[name] = True
+        else:
+            for name in self.grad_names:
+                copied.set_grad(name, self.get_grad(name).copy())
         return cast(SelfT, copied)
 
     def to_gpu(self, gpu_id: int) -> None:  # pragma: no cover
@@ -413,13 +586,14 @@ class Model(Generic[InT, OutT]):
 
     def _to_ops(self, ops: Ops) -> None:  # pragma: no cover
         """Common method for to_cpu/to_gpu."""
-        for node in self.walk():
+        nodes, slots = self._get_index()
+        for node, name in slots:
+            if node.has_param(name):
+                node.set_param(name, _to_ops_array(ops, node.get_param(name)))
+            if node.has_grad(name):
+                node.set_grad(name, _to_ops_array(ops, node.get_grad(name)))
+        for node in nodes:
             node.ops = ops
-            for name in node.param_names:
-                if node.has_param(name):
-                    node.set_param(name, ops.asarray_f(node.get_param(name)))
-                if node.has_grad(name):
-                    node.set_grad(name, ops.asarray_f(node.get_grad(name)))
             for shim in node.shims:
                 shim.to_device(ops.device_type)
 
@@ -454,7 +628,7 @@ class Model(Generic[InT, OutT]):
         # small. The attrs are probably not very large, but could be.
         # The lists are aligned, and refer to the order of self.walk().
         msg: Dict[str, List] = {"nodes": [], "attrs": [], "params": [], "shims": []}
-        nodes = list(self.walk())
+        nodes, slots = self._get_index()
         # Serialize references by their index into the flattened tree.
         # This is the main reason we can't accept out-of-tree references:
         # we'd have no way to serialize/deserialize them.
@@ -490,14 +664,14 @@ class Model(Generic[InT, OutT]):
             msg["attrs"].append(attrs)
         for node in nodes:
             msg["shims"].append([shim.to_bytes() for shim in node.shims])
-        for node in nodes:
-            params: Dict[str, Optional[FloatsXd]] = {}
-            for name in node.param_names:
-                if node.has_param(name):
-                    params[name] = cast(Optional[FloatsXd], node.get_param(name))
-                else:
-                    params[name] = None
-            msg["params"].append(params)
+        params: Dict[int, Dict[str, Optional[FloatsXd]]]
+        params = {node.id: {} for node in nodes}
+        for node, name in slots:
+            if node.has_param(name):
+                params[node.id][name] = cast(Optional[FloatsXd], node.get_param(name))
+            else:
+                params[node.id][name] = None
+        msg["params"].extend(params[node.id] for node in nodes)
         return msg
 
     def from_bytes(self, bytes_data: bytes) -> "Model":
@@ -652,6 +826,14 @@ def deserialize_attr(_: Any, value: Any, name: str, model: Model) -> Any:
     return srsly.msgpack_loads(value)
 
 
+def _to_ops_array(ops: Ops, array: ArrayXd) -> ArrayXd:
+    # Floats are cast to float32, while integer parameters, like the int8
+    # weights or the sparse indices, keep their dtype.
+    if array.dtype.kind == "f":
+        return ops.asarray_f(array)
+    return ops.asarray(array)
+
+
 def _jax_flatten_model(model):  # pragma: ignore
     """A Jax flattener for Thinc models. Registering this (and the paired
     unflatten function) allows Thinc models to be passed into Jax JIT-ed functions.
@@ -726,6 +908,7 @@ def set_dropout_rate(model: _ModelT, drop: float, attrs=["dropout_rate"]) -> _Mo
 
 __all__ = [
     "Model",
+    "no_grad",
     "serialize_attr",
     "deserialize_attr",
     "change_attr_values",
@@ -245,6 +245,7 @@ class Optimizer(object):
         if len(gradient) < 1:
             return weights, gradient
         xp = self.ops.xp
+        grad_buffer = gradient
         self.nr_update[key] += 1
         nr_upd = self.nr_update[key]
         if self.L2 != 0 and not self.L2_is_weight_decay:
@@ -261,7 +262,14 @@ class Optimizer(object):
             raise NotImplementedError  # TODO: error message
         else:
             weights -= lr_scale * self.learn_rate * gradient
-        gradient = gradient * 0.0
+        # Zero the caller's gradient in place, so the same buffer can be used
+        # to accumulate the next batch, instead of allocating a new one.
+        if hasattr(grad_buffer, "fill"):
+            grad_buffer.fill(0)
+            gradient = grad_buffer
+        else:  # pragma: no cover
+            # Immutable arrays, e.g. for Jax
+            gradient = gradient * 0.0
         if self.L2 != 0 and self.L2_is_weight_decay:
             weights -= self.L2 * weights
         if self.averages is not None:
@@ -0,0 +1,282 @@
+from typing import Any, Callable, List, Optional, Sequence, Tuple, TypeVar
+from concurrent.futures import ThreadPoolExecutor
+import contextvars
+import mmap
+import multiprocessing
+import os
+import threading
+import traceback
+import numpy
+
+from .model import Model
+from .optimizers import Optimizer
+
+
+T = TypeVar("T")
+
+_thread_pool: Optional[ThreadPoolExecutor] = None
+_thread_pool_lock = threading.Lock()
+_thread_local = threading.local()
+
+
+def set_thread_pool_size(n_threads: int) -> None:
+    """Set the number of threads of the pool that runs the branches of
+    parallel layers. Defaults to the number of CPUs.
+    """
+    global _thread_pool
+    if n_threads < 1:
+        raise ValueError(f"Invalid number of threads: {n_threads}")
+    with _thread_pool_lock:
+        if _thread_pool is not None:
+            _thread_pool.shutdown(wait=True)
+        _thread_pool = ThreadPoolExecutor(max_workers=n_threads)
+
+
+def get_thread_pool() -> ThreadPoolExecutor:
+    """Get the thread pool shared by parallel layers, creating it if needed."""
+    global _thread_pool
+    with _thread_pool_lock:
+        if _thread_pool is None:
+            _thread_pool = ThreadPoolExecutor(max_workers=os.cpu_count() or 1)
+        return _thread_pool
+
+
+def run_parallel(funcs: Sequence[Callable[[], T]]) -> List[T]:
+    """Run independent callables concurrently on the shared thread pool, and
+    return their results in order. The heavy kernels release the GIL, so the
+    branches of a layer can use several cores. The first callable runs in the
+    calling thread. Calls made from inside the pool run sequentially, so
+    nested parallel layers can't deadlock waiting for a free thread.
+    """
+    if len(funcs) < 2 or getattr(_thread_local, "in_pool", False):
+        return [func() for func in funcs]
+    pool = get_thread_pool()
+    # Context variables (e.g. the no_grad() flag) don't propagate to pool
+    # threads by themselves, so each task runs in a copy of ours.
+    futures = [
+        pool.submit(contextvars.copy_context().run, _run_in_pool, func)
+        for func in funcs[1:]
+    ]
+    try:
+        first = funcs[0]()
+    finally:
+        results = [future.result() for future in futures]
+    return [first] + results
+
+
+def _run_in_pool(func: Callable[[], T]) -> T:
+    _thread_local.in_pool = True
+    try:
+        return func()
+    finally:
+        _thread_local.in_pool = False
+
+
+class DataParallel:
+    """Train a model with several worker processes on a single machine. The
+    parameters live in an arena of shared memory, which the workers inherit
+    when they're forked, so weights are never pickled or sent between
+    processes. Each call to `update` splits the batch into one shard per
+    worker. The workers compute the gradients for their shard, write them into
+    their own slab of the arena, and then sum the slabs together with a
+    reduce-scatter: every worker reduces a different chunk of the parameters.
+    The parent process then takes a single optimizer step on the reduced
+    gradients, updating the shared parameters in place.
+
+    Gradients are averaged over the shards, weighted by the shard sizes. This
+    matches a full-batch update for losses that are normalized by the batch
+    size, like the default `CategoricalCrossentropy`. Only float32 parameters
+    on CPU are supported, and the structure of the model shouldn't change
+    while the workers are running.
+
+    EXAMPLE:
+        with DataParallel(model, optimizer, CategoricalCrossentropy(), 4) as trainer:
+            for X, Y in model.ops.multibatch(128, train_X, train_Y, shuffle=True):
+                loss = trainer.update(X, Y)
+    """
+
+    def __init__(
+        self,
+        model: Model,
+        optimizer: Optimizer,
+        get_loss: Callable[[Any, Any], Tuple[Any, float]],
+        n_workers: int,
+    ):
+        if n_workers < 1:
+            raise ValueError(f"Invalid number of workers: {n_workers}")
+        if "fork" not in multiprocessing.get_all_start_methods():
+            raise ValueError("DataParallel requires the 'fork' start method")
+        nodes, slots = model._get_index()
+        if any(node.shims for node in nodes):
+            raise ValueError("DataParallel doesn't support models with shims")
+        self.model = model
+        self.optimizer = optimizer
+        self.get_loss = get_loss
+        self.n_workers = n_workers
+        self._slots: List[Tuple[Model, str, int, Tuple[int, ...]]] = []
+        n_params = 0
+        for node, name in slots:
+            if not node.has_param(name):
+                continue
+            param = node.get_param(name)
+            if not isinstance(param, numpy.ndarray) or param.dtype != "float32":
+                err = f"DataParallel needs float32 numpy parameters: '{name}' for model '{node.name}'"
+                raise ValueError(err)
+            self._slots.append((node, name, n_params, param.shape))
+            n_params += param.size
+        self._n_params = n_params
+        # Layout: the parameters, one gradient slab per worker, and the reduced
+        # gradients. An anonymous shared mapping stays shared after fork().
+        self._mmap = mmap.mmap(-1, 4 * max(1, n_params * (n_workers + 2)))
+        arena = numpy.frombuffer(self._mmap, dtype="float32")
+        self._params = arena[:n_params]
+        self._slabs = [
+            arena[n_params * (i + 1) : n_params * (i + 2)] for i in range(n_workers)
+        ]
+        self._reduced = arena[n_params * (n_workers + 1) : n_params * (n_workers + 2)]
+        for node, name, start, shape in self._slots:
+            view = self._view(self._params, start, shape)
+            view[...] = node.get_param(name)
+            node.set_param(name, view)
+        # The workers would inherit the same random state, and so e.g. draw the
+        # same dropout masks, so each one is reseeded from a base seed drawn
+        # here. This keeps runs reproducible under fix_random_seed.
+        self._seed = int(numpy.random.randint(0, 2 ** 32 - n_workers))
+        context = multiprocessing.get_context("fork")
+        self._barrier = context.Barrier(n_workers)
+        self._conns = []
+        self._procs = []
+        for rank in range(n_workers):
+            parent_conn, child_conn = context.Pipe()
+            proc = context.Process(target=self._work, args=(rank, child_conn))
+            proc.daemon = True
+            proc.start()
+            child_conn.close()
+            self._conns.append(parent_conn)
+            self._procs.append(proc)
+
+    def __enter__(self) -> "DataParallel":
+        return self
+
+    def __exit__(self, *args) -> None:
+        self.close()
+
+    def update(self, X: Sequence, Y: Sequence) -> float:
+        """Compute the gradients for a batch with the workers, and update the
+        shared parameters with the optimizer. Returns the loss, averaged over
+        the shards.
+        """
+        if not self._procs:
+            raise ValueError("Cannot update: the workers have been closed")
+        if len(X) != len(Y):
+            raise ValueError(f"Mismatched batch sizes: {len(X)} vs {len(Y)}")
+        if len(X) == 0:
+            return 0.0
+        bounds = numpy.linspace(0, len(X), self.n_workers + 1).astype("i")
+        for conn, start, end in zip(self._conns, bounds, bounds[1:]):
+            conn.send((X[start:end], Y[start:end], (end - start) / len(X)))
+        loss = 0.0
+        errors = []
+        for conn in self._conns:
+            status, value = conn.recv()
+            if status == "ok":
+                loss += value
+            else:
+                errors.append(value)
+        if errors:
+            self.close()
+            raise RuntimeError(f"DataParallel worker failed:\n{errors[0]}")
+        self._finish_update()
+        return loss
+
+    def close(self) -> None:
+        """Stop the workers, and copy the parameters out of the shared arena
+        so that the model can be used on its own again.
+        """
+        for conn, proc in zip(self._conns, self._procs):
+            if proc.is_alive():
+                try:
+                    conn.send(None)
+                except (BrokenPipeError, OSError):  # pragma: no cover
+                    pass
+            proc.join(timeout=10)
+            if proc.is_alive():  # pragma: no cover
+                proc.terminate()
+            conn.close()
+        self._conns = []
+        self._procs = []
+        for node, name, start, shape in self._slots:
+            node.set_param(name, self._view(self._params, start, shape).copy())
+
+    def _finish_update(self) -> None:
+        for node, name, start, shape in self._slots:
+            grad = self._view(self._reduced, start, shape)
+            view = self._view(self._params, start, shape)
+            param, grad = self.optimizer((node.id, name), view, grad)
+            if param is not view:
+                view[...] = param
+            node.set_param(name, view)
+
+    def _work(self, rank: int, conn: Any) -> None:
+        for parent_conn in self._conns:
+            parent_conn.close()
+        numpy.random.seed(self._seed + rank)
+        slab = self._slabs[rank]
+        slab.fill(0)
+        # Point the gradients at our slab, so inc_grad accumulates into it
+        # directly.
+        for node, name, start, shape in self._slots:
+            node.set_grad(name, self._view(slab, start, shape))
+        n_chunk = -(-self._n_params // self.n_workers)
+        lo = min(rank * n_chunk, self._n_params)
+        hi = min(lo + n_chunk, self._n_params)
+        while True:
+            msg = conn.recv()
+            if msg is None:
+                break
+            X, Y, weight = msg
+            try:
+                loss = self._work_step(X, Y, weight, slab, lo, hi)
+            except threading.BrokenBarrierError:
+                conn.send(("error", f"Worker {rank} aborted by another worker"))
+            except Exception:
+                self._barrier.abort()
+                conn.send(("error", traceback.format_exc()))
+            else:
+                conn.send(("ok", loss))
+        conn.close()
+
+    def _work_step(
+        self, X: Any, Y: Any, weight: float, slab: numpy.ndarray, lo: int, hi: int
+    ) -> float:
+        # The parent updated the shared parameters in place, so set them again
+        # to invalidate anything cached from their old values, like packed
+        # weights.
+        for node, name, start, shape in self._slots:
+            node.set_param(name, self._view(self._params, start, shape))
+        if len(X):
+            Yh, backprop = self.model.begin_update(X)
+            dY, loss = self.get_loss(Yh, Y)
+            backprop(dY)
+            slab *= weight
+        else:
+            loss = 0.0
+        self._barrier.wait()
+        # Reduce-scatter: each worker sums its own chunk over all the slabs.
+        reduced = self._reduced[lo:hi]
+        reduced[...] = self._slabs[0][lo:hi]
+        for other in self._slabs[1:]:
+            reduced += other[lo:hi]
+        self._barrier.wait()
+        slab.fill(0)
+        return float(loss) * weight
+
+    @staticmethod
+    def _view(
+        arena: numpy.ndarray, start: int, shape: Tuple[int, ...]
+    ) -> numpy.ndarray:
+        size = int(numpy.prod(shape))
+        return arena[start : start + size].reshape(shape)
+
+
+__all__ = ["DataParallel", "run_parallel", "set_thread_pool_size", "get_thread_pool"]
@@ -0,0 +1,102 @@
+from typing import Callable, Dict, Iterator
+from contextvars import ContextVar
+import contextlib
+
+from .config import registry
+from .model import Model
+from .types import ArrayXd, Floats2d, FloatStorage
+
+
+class Precision:
+    """A mixed-precision policy for the Linear, Maxout, Softmax and
+    MultiSoftmax layers. `params` sets how the copies of the weights that are
+    used for inference, i.e. under `no_grad()`, are stored, and `activations`
+    sets how the inputs that the layers keep for the backward pass are stored.
+    The values can be "float32", "float16" or "bfloat16". Products are still
+    accumulated in float32, and the parameters that the optimizer updates stay
+    float32, so they act as the master copy the reduced copies are made from.
+    """
+
+    def __init__(
+        self, params: FloatStorage = "float32", activations: FloatStorage = "float32"
+    ):
+        for name, storage in (("params", params), ("activations", activations)):
+            if storage not in ("float32", "float16", "bfloat16"):
+                err = f"Invalid storage for {name}: '{storage}'. Expected float32, float16 or bfloat16"
+                raise ValueError(err)
+        self.params = params
+        self.activations = activations
+
+    def __repr__(self) -> str:
+        return f"Precision(params={self.params!r}, activations={self.activations!r})"
+
+
+@registry.precisions("mixed_precision.v1")
+def mixed_precision(
+    params: FloatStorage = "bfloat16", activations: FloatStorage = "bfloat16"
+) -> Precision:
+    """Create a mixed-precision policy, to be passed to `set_current_precision`.
+
+    EXAMPLE:
+        [precision]
+        @precisions = "mixed_precision.v1"
+        params = "bfloat16"
+        activations = "float16"
+    """
+    return Precision(params=params, activations=activations)
+
+
+context_precision: ContextVar[Precision] = ContextVar(
+    "context_precision", default=Precision()
+)
+
+
+def get_current_precision() -> Precision:
+    """Get the current mixed-precision policy."""
+    return context_precision.get()
+
+
+def set_current_precision(precision: Precision) -> None:
+    """Change the current mixed-precision policy."""
+    context_precision.set(precision)
+
+
+@contextlib.contextmanager
+def use_precision(precision: Precision) -> Iterator[None]:
+    """Change the mixed-precision policy for the scope of the block."""
+    token = context_precision.set(precision)
+    try:
+        yield
+    finally:
+        context_precision.reset(token)
+
+
+def forward_compressed(model: Model, X: Floats2d, storage: FloatStorage) -> Floats2d:
+    """Compute X @ W.T + b with a copy of the weights in the given storage
+    type. The copy is made on first use and kept until W is set again.
+    """
+    copies = model.get_packed_param("W", _new_copies)
+    W = copies.get(storage)
+    if W is None:
+        W = model.get_param("W")
+        W = model.ops.reshape2f(W, -1, W.shape[-1])
+        W = copies[storage] = model.ops.compress_floats(W, storage)
+    Y = model.ops.gemm_compressed(model.ops.as_contig(X), W, storage)
+    Y += model.ops.reshape1f(model.get_param("b"), Y.shape[1])
+    return Y
+
+
+def save_input(
+    model: Model, X: Floats2d, storage: FloatStorage
+) -> Callable[[], Floats2d]:
+    """Keep a layer's input for the backward pass in the given storage type,
+    returning a callback that gets it back as float32.
+    """
+    if storage == "float32":
+        return lambda: X
+    X_saved = model.ops.compress_floats(X, storage)
+    return lambda: model.ops.decompress_floats(X_saved, storage)
+
+
+def _new_copies(W: ArrayXd) -> Dict[str, ArrayXd]:
+    return {}
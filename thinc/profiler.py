@@ -0,0 +1,332 @@
+from typing import Any, Callable, Dict, Iterator, List, Optional, Tuple, Union
+from pathlib import Path
+import contextlib
+import os
+import threading
+import time
+import srsly
+from wasabi import table
+
+from .model import Model
+from .backends import Ops, _memory
+from .backends._memory import MemoryTracker
+from .types import Ragged, Padded
+from .util import format_bytes
+
+
+class Profiler(MemoryTracker):
+    """Collect timings, call counts, shapes, allocations and FLOP estimates
+    for every node of a model. Use `profile_model` to create one, and read
+    the results with `get_stats`, `format_table` or `to_chrome_trace`.
+
+    Times are recorded separately for the forward and backward passes. The
+    total time of a node includes its children, while the self time doesn't.
+    The profiler is a MemoryTracker, so it shares its node stack and
+    allocation hook: the bytes of the arrays created through the Ops are
+    attributed to the innermost node that's running, and `step()` reports the
+    peak memory. FLOPs are estimated for `gemm` (2 * M * N * K) and the ops
+    built on it: `window_gemm`, `gemm_int8`, `gemm_compressed`, `sparse_gemm`
+    (2 * M * nnz) and their backward passes. The GEMMs that other ops run
+    internally aren't counted. The stats are aggregated by node name.
+    """
+
+    def __init__(self, *, max_events: int = 100000, top_k: int = 10):
+        super().__init__(top_k=top_k)
+        self.max_events = max_events
+        self.events: List[Dict[str, Any]] = []
+        self.stats: Dict[str, Dict[str, Any]] = {}
+        self._start = time.perf_counter()
+
+    def reset(self) -> None:
+        """Clear the events and stats collected so far."""
+        with self._lock:
+            self.events = []
+            self.stats = {}
+            self._start = time.perf_counter()
+
+    def get_stats(self) -> Dict[str, Dict[str, Any]]:
+        """Get the stats per node name, sorted by total time spent in the
+        node's own code.
+        """
+        with self._lock:
+            stats = {name: dict(values) for name, values in self.stats.items()}
+        for values in stats.values():
+            values["shapes"] = sorted(values["shapes"])
+        get_self_time = lambda item: item[1]["self_forward"] + item[1]["self_backward"]
+        return dict(sorted(stats.items(), key=get_self_time, reverse=True))
+
+    def format_table(self, *, limit: Optional[int] = None) -> str:
+        """Format the stats as a text table, with the hottest nodes first."""
+        rows = []
+        for name, s in list(self.get_stats().items())[:limit]:
+            rows.append(
+                (
+                    name,
+                    s["n_forward"],
+                    s["n_backward"],
+                    f"{s['time_forward'] * 1e3:.2f}",
+                    f"{s['time_backward'] * 1e3:.2f}",
+                    f"{(s['self_forward'] + s['self_backward']) * 1e3:.2f}",
+                    format_bytes(s["alloc_bytes"]),
+                    _format_flops(s["flops"]),
+                    " ".join(s["shapes"][:3]),
+                )
+            )
+        header = (
+            "Node",
+            "Fwd calls",
+            "Bwd calls",
+            "Fwd ms",
+            "Bwd ms",
+            "Self ms",
+            "Alloc",
+            "FLOPs",
+            "Shapes (in -> out)",
+        )
+        return table(rows, header=header, divider=True)
+
+    def to_chrome_trace(self, path: Optional[Union[str, Path]] = None) -> Dict:
+        """Export the recorded events in the Chrome trace-event format, which
+        can be loaded in chrome://tracing or Perfetto. If a path is given, the
+        trace is also written to it as JSON.
+        """
+        with self._lock:
+            events = list(self.events)
+        trace = {"traceEvents": events, "displayTimeUnit": "ms"}
+        if path is not None:
+            srsly.write_json(path, trace)
+        return trace
+
+    def call(self, model: Model, X: Any, is_train: bool) -> Tuple[Any, Callable]:
+        """Call a model's forward function, timing it and attributing its
+        allocations and FLOPs to the model's node. The backward pass is
+        profiled the same way.
+        """
+        Y, backprop = self._profile(
+            model,
+            "forward",
+            lambda: model._func(model, X, is_train=is_train),
+            get_shape=lambda result: f"{_get_shape(X)} -> {_get_shape(result[0])}",
+        )
+
+        def profiled_backprop(dY: Any) -> Any:
+            return self._profile(model, "backward", lambda: backprop(dY))
+
+        return Y, profiled_backprop
+
+    def track(self, array: Any) -> None:
+        super().track(array)
+        stack = self._get_stack()
+        if stack and "alloc_bytes" in stack[-1]:
+            stack[-1]["alloc_bytes"] += int(getattr(array, "nbytes", 0))
+
+    def _profile(
+        self,
+        model: Model,
+        phase: str,
+        func: Callable,
+        get_shape: Optional[Callable] = None,
+    ) -> Any:
+        start = time.perf_counter()
+        shape = None
+        with self.node(model.name) as frame:
+            frame.update({"child_time": 0.0, "alloc_bytes": 0, "flops": 0})
+            try:
+                result = func()
+                # The shapes are only recorded for calls that didn't raise.
+                if get_shape is not None:
+                    shape = get_shape(result)
+                return result
+            finally:
+                duration = time.perf_counter() - start
+                # The frame is still on top of the stack, so the parent's is
+                # below it.
+                stack = self._get_stack()
+                if len(stack) >= 2 and "child_time" in stack[-2]:
+                    stack[-2]["child_time"] += duration
+                self._record(model, phase, frame, start, duration, shape)
+
+    def _record(
+        self,
+        model: Model,
+        phase: str,
+        frame: Dict[str, Any],
+        start: float,
+        duration: float,
+        shape: Optional[str],
+    ) -> None:
+        self_time = duration - frame["child_time"]
+        with self._lock:
+            stats = self.stats.get(model.name)
+            if stats is None:
+                stats = self.stats[model.name] = {
+                    "n_forward": 0,
+                    "n_backward": 0,
+                    "time_forward": 0.0,
+                    "time_backward": 0.0,
+                    "self_forward": 0.0,
+                    "self_backward": 0.0,
+                    "alloc_bytes": 0,
+                    "flops": 0,
+                    "shapes": set(),
+                }
+            stats[f"n_{phase}"] += 1
+            stats[f"time_{phase}"] += duration
+            stats[f"self_{phase}"] += self_time
+            stats["alloc_bytes"] += frame["alloc_bytes"]
+            stats["flops"] += frame["flops"]
+            if shape is not None and len(stats["shapes"]) < 16:
+                stats["shapes"].add(shape)
+            if len(self.events) < self.max_events:
+                args = {
+                    "id": model.id,
+                    "alloc_bytes": frame["alloc_bytes"],
+                    "flops": frame["flops"],
+                }
+                if shape is not None:
+                    args["shapes"] = shape
+                self.events.append(
+                    {
+                        "name": model.name,
+                        "cat": phase,
+                        "ph": "X",
+                        "ts": (start - self._start) * 1e6,
+                        "dur": duration * 1e6,
+                        "pid": os.getpid(),
+                        "tid": threading.get_ident(),
+                        "args": args,
+                    }
+                )
+
+    def _count_flops(self, flops: int) -> None:
+        stack = self._get_stack()
+        if stack and "flops" in stack[-1]:
+            stack[-1]["flops"] += flops
+
+
+@contextlib.contextmanager
+def profile_model(model: Model, *, max_events: int = 100000) -> Iterator[Profiler]:
+    """Profile the nodes that run while the context is active, and yield a
+    Profiler that collects the results. The profiler is the active memory
+    tracker for the duration, so it can't be combined with `track_memory`.
+    The FLOP counters are installed on the Ops of the nodes in
+    `model.walk()`, and removed when the context exits.
+
+    EXAMPLE:
+        with profile_model(model) as profiler:
+            Y, backprop = model.begin_update(X)
+            backprop(dY)
+        print(profiler.format_table())
+        profiler.to_chrome_trace("trace.json")
+    """
+    profiler = Profiler(max_events=max_events)
+    ops_list: List[Ops] = []
+    for node in model.walk():
+        if not any(ops is node.ops for ops in ops_list):
+            ops_list.append(node.ops)
+    with _memory.use_tracker(profiler):
+        try:
+            for ops in ops_list:
+                _instrument_ops(profiler, ops)
+            yield profiler
+        finally:
+            for ops in ops_list:
+                for name in _FLOP_COUNTS:
+                    ops.__dict__.pop(name, None)
+
+
+def _gemm_flops(x, y, out=None, trans1=False, trans2=False) -> int:
+    M = x.shape[1] if trans1 else x.shape[0]
+    K = x.shape[0] if trans1 else x.shape[1]
+    N = y.shape[0] if trans2 else y.shape[1]
+    return 2 * M * N * K
+
+
+def _window_gemm_flops(X, W, nW, *, lengths=None) -> int:
+    # W is either (nO, nF * nI), or packed as (nF, nO, nI).
+    nO = W.shape[1] if W.ndim == 3 else W.shape[0]
+    return 2 * X.shape[0] * X.shape[1] * nO * (nW * 2 + 1)
+
+
+def _backprop_window_gemm_flops(dY, X, W, nW, *, lengths=None) -> int:
+    return 2 * _window_gemm_flops(X, W, nW)
+
+
+def _gemm_int8_flops(X, W, W_scale, *, X_scale=None) -> int:
+    return 2 * X.shape[0] * X.shape[1] * W.shape[0]
+
+
+def _gemm_compressed_flops(X, W, storage) -> int:
+    return 2 * X.shape[0] * X.shape[1] * W.shape[0]
+
+
+def _sparse_gemm_flops(X, data, indices, indptr) -> int:
+    return 2 * X.shape[0] * data.shape[0]
+
+
+def _backprop_sparse_gemm_flops(dY, X, data, indices, indptr) -> int:
+    return 4 * X.shape[0] * data.shape[0]
+
+
+# The ops whose FLOPs are counted, and how to compute them from the arguments.
+_FLOP_COUNTS: Dict[str, Callable[..., int]] = {
+    "gemm": _gemm_flops,
+    "window_gemm": _window_gemm_flops,
+    "backprop_window_gemm": _backprop_window_gemm_flops,
+    "gemm_int8": _gemm_int8_flops,
+    "gemm_compressed": _gemm_compressed_flops,
+    "sparse_gemm": _sparse_gemm_flops,
+    "backprop_sparse_gemm": _backprop_sparse_gemm_flops,
+}
+
+
+def _instrument_ops(profiler: Profiler, ops: Ops) -> None:
+    # Ops like window_gemm are built on gemm, so only the outermost counted
+    # call on each thread adds its FLOPs.
+    local = threading.local()
+
+    def count_flops(method: Callable, get_flops: Callable) -> Callable:
+        def profiled_method(*args, **kwargs):
+            depth = getattr(local, "depth", 0)
+            if depth == 0:
+                profiler._count_flops(get_flops(*args, **kwargs))
+            local.depth = depth + 1
+            try:
+                return method(*args, **kwargs)
+            finally:
+                local.depth = depth
+
+        return profiled_method
+
+    # Patch the instance, so the class and other Ops objects are unaffected.
+    for name, get_flops in _FLOP_COUNTS.items():
+        method = getattr(ops, name, None)
+        if method is not None:
+            ops.__dict__[name] = count_flops(method, get_flops)
+
+
+def _get_shape(X: Any) -> str:
+    if hasattr(X, "shape"):
+        return "x".join(str(dim) for dim in X.shape) or "()"
+    elif isinstance(X, Ragged):
+        return f"Ragged({_get_shape(X.dataXd)})"
+    elif isinstance(X, Padded):
+        return f"Padded({_get_shape(X.data)})"
+    elif isinstance(X, (list, tuple)):
+        if X and all(hasattr(x, "shape") for x in X):
+            width = "x".join(str(dim) for dim in X[0].shape[1:])
+            return f"{type(X).__name__}[{len(X)}]({width})"
+        return f"{type(X).__name__}[{len(X)}]"
+    else:
+        return type(X).__name__
+
+
+def _format_flops(flops: int) -> str:
+    if flops >= 1e9:
+        return f"{flops / 1e9:.2f} G"
+    elif flops >= 1e6:
+        return f"{flops / 1e6:.2f} M"
+    return str(flops)
+
+
+__all__ = ["Profiler", "profile_model"]
@@ -0,0 +1,133 @@
+from typing import Any, Callable, Iterable, Iterator, List, Optional, Sequence
+from typing import Tuple, Union
+
+from .model import Model, NO_GRAD, no_backprop
+from .types import Floats2d
+
+
+# The names of the layers that `MagnitudePruner` and `sparsify` convert.
+PRUNE_LAYERS = ("linear", "maxout")
+
+
+class MagnitudePruner:
+    """Zero the weights with the smallest absolute values in the Linear and
+    Maxout layers of a model, so that the given fraction of each layer's
+    weights is zero. The sparsity can be a float or a schedule, i.e. an
+    iterable of floats, which is advanced each time the pruner is called.
+    When the schedule is exhausted, its last value is kept. Call the pruner
+    after each `finish_update` to prune gradually while training, then call
+    `sparsify` to store the weights in sparse form.
+
+    EXAMPLE:
+        pruner = MagnitudePruner(compounding(0.01, 0.9, 1.005))
+        for X, Y in batches:
+            ...
+            model.finish_update(optimizer)
+            pruner(model)
+        sparsify(model)
+    """
+
+    def __init__(
+        self,
+        sparsity: Union[float, Iterable[float]],
+        *,
+        layers: Sequence[str] = PRUNE_LAYERS,
+    ):
+        self.layers = tuple(layers)
+        self.schedule: Optional[Iterator[float]] = None
+        if isinstance(sparsity, (int, float)):
+            self.sparsity = _check_sparsity(sparsity)
+        else:
+            self.schedule = iter(sparsity)
+            self.sparsity = _check_sparsity(next(self.schedule))
+
+    def __call__(self, model: Model) -> float:
+        """Prune the model in place, advance the schedule and return the
+        sparsity that was used.
+        """
+        sparsity = self.sparsity
+        for node in _get_nodes(model, self.layers):
+            prune_weights(node, sparsity)
+        if self.schedule is not None:
+            try:
+                self.sparsity = _check_sparsity(next(self.schedule))
+            except StopIteration:  # schedule exhausted, use last value
+                pass
+        return sparsity
+
+
+def prune_weights(model: Model, sparsity: float) -> None:
+    """Set the given fraction of a layer's weights "W" to zero, starting from
+    the smallest absolute values.
+    """
+    W = model.get_param("W")
+    n_zeros = int(round(_check_sparsity(sparsity) * W.size))
+    if n_zeros == 0:
+        return
+    xp = model.ops.xp
+    W = W.copy()
+    flat = W.reshape((-1,))
+    if n_zeros >= W.size:
+        flat.fill(0)
+    else:
+        flat[xp.argpartition(xp.abs(flat), n_zeros - 1)[:n_zeros]] = 0
+    model.set_param("W", W)
+
+
+def sparsify(model: Model, *, layers: Sequence[str] = PRUNE_LAYERS) -> Model:
+    """Convert the weights of the Linear and Maxout layers of a model to
+    compressed sparse row (CSR) form in place, keeping only the non-zero
+    values, e.g. after pruning with `MagnitudePruner`. The dense weights are
+    dropped. The layers then compute with `ops.sparse_gemm`, whose cost is
+    proportional to the number of non-zero weights, and can still be trained:
+    only the non-zero values are updated, so the sparsity is kept. The sparse
+    weights are saved by `to_bytes` and loaded by `from_bytes` like other
+    parameters.
+    """
+    for node in _get_nodes(model, layers):
+        W = node.get_param("W")
+        W2d = node.ops.reshape2f(W, -1, W.shape[-1])
+        rows, cols = node.ops.xp.nonzero(W2d)
+        counts = (W2d != 0).sum(axis=1)
+        indptr = node.ops.alloc1i(W2d.shape[0] + 1)
+        indptr[1:] = node.ops.xp.cumsum(counts)
+        node.set_param("W_data", node.ops.as_contig(W2d[rows, cols], dtype="f"))
+        node.set_param("W_indices", node.ops.asarray1i(cols))
+        node.set_param("W_indptr", indptr)
+        node._params.remove_param(node.id, "W")
+        node.set_param("W", None)
+    return model
+
+
+def forward_sparse(model: Model, X: Floats2d) -> Tuple[Floats2d, Callable]:
+    """Compute X @ W.T + b for a layer converted by `sparsify`, returning the
+    output and a callback to compute the gradient of the input.
+    """
+    data = model.get_param("W_data")
+    indices = model.get_param("W_indices")
+    indptr = model.get_param("W_indptr")
+    b = model.get_param("b")
+    X = model.ops.as_contig(X)
+    Y = model.ops.sparse_gemm(X, data, indices, indptr)
+    Y += model.ops.reshape1f(b, Y.shape[1])
+    if NO_GRAD.get():
+        return Y, no_backprop
+
+    def backprop(dY: Floats2d) -> Floats2d:
+        dY = model.ops.as_contig(dY)
+        model.inc_grad("b", model.ops.reshape_f(dY.sum(axis=0), b.shape))
+        dX, d_data = model.ops.backprop_sparse_gemm(dY, X, data, indices, indptr)
+        model.inc_grad("W_data", d_data)
+        return dX
+
+    return Y, backprop
+
+
+def _get_nodes(model: Model, layers: Sequence[str]) -> List[Model]:
+    return [n for n in model.walk() if n.name in layers and n.has_param("W")]
+
+
+def _check_sparsity(sparsity: Any) -> float:
+    if not 0.0 <= sparsity <= 1.0:
+        raise ValueError(f"Invalid sparsity: {sparsity}. Expected 0.0 <= x <= 1.0")
+    return float(sparsity)
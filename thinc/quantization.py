@@ -0,0 +1,140 @@
+from typing import Any, Dict, Iterable, List, Optional
+import numpy
+
+from .model import Model
+from .types import Floats2d, Ragged, Padded
+
+
+# The names of the layers that `quantize_int8` converts.
+INT8_LAYERS = ("linear", "maxout", "softmax", "multisoftmax")
+
+
+def quantize_int8(
+    model: Model,
+    *,
+    calibration_data: Optional[Iterable[Any]] = None,
+    percentile: float = 100.0,
+) -> Model:
+    """Convert the weights of the Linear, Maxout, Softmax and MultiSoftmax
+    layers of a model to int8 in place, for inference on CPU. Each output
+    channel gets its own scale. The float weights are dropped, so the weights
+    take a quarter of the memory, and the quantized weights are saved by
+    `to_bytes` and loaded by `from_bytes` like other parameters. Quantized
+    layers can't be trained.
+
+    By default, each row of a layer's input is quantized with its own scale,
+    computed on the fly. If `calibration_data` is given, the model is run on
+    the batches first to fix each layer's input scale, so that the values
+    above the given percentile of the largest absolute value per row are
+    clipped.
+
+    EXAMPLE:
+        reference = model.copy()
+        quantize_int8(model, calibration_data=dev_batches[:10])
+        print(compare_predictions(reference, model, dev_batches))
+    """
+    nodes = [n for n in model.walk() if n.name in INT8_LAYERS and n.has_param("W")]
+    input_scales: Dict[int, float] = {}
+    if calibration_data is not None:
+        input_scales = _calibrate(model, nodes, calibration_data, percentile)
+    for node in nodes:
+        W = node.get_param("W")
+        W2d = node.ops.reshape2f(W, -1, W.shape[-1])
+        W_int8, W_scale = node.ops.quantize_int8(W2d)
+        node.set_param("W_int8", W_int8)
+        node.set_param("W_scale", W_scale)
+        node._params.remove_param(node.id, "W")
+        node.set_param("W", None)
+        node.attrs["int8_input_scale"] = input_scales.get(node.id)
+    return model
+
+
+def forward_int8(model: Model, X: Floats2d) -> Floats2d:
+    """Compute X @ W.T + b for a layer converted by `quantize_int8`."""
+    Y = model.ops.gemm_int8(
+        model.ops.as_contig(X),
+        model.get_param("W_int8"),
+        model.get_param("W_scale"),
+        X_scale=model.attrs.get("int8_input_scale"),
+    )
+    Y += model.ops.reshape1f(model.get_param("b"), Y.shape[1])
+    return Y
+
+
+def backprop_int8(dY: Any) -> Any:
+    """Callback returned by the forward passes of quantized layers."""
+    raise ValueError("Cannot backprop through a layer quantized to int8")
+
+
+def compare_predictions(
+    reference: Model, model: Model, batches: Iterable[Any]
+) -> Dict[str, float]:
+    """Compare the predictions of a model to those of a reference model, e.g.
+    a quantized model to the original. Returns the largest and the mean
+    absolute difference of the outputs, and how often their argmax over the
+    last axis agrees.
+    """
+    max_diff = 0.0
+    total_diff = 0.0
+    n_values = 0
+    n_agree = 0
+    n_rows = 0
+    for X in batches:
+        expected = _get_output_array(reference, reference.predict(X))
+        predicted = _get_output_array(model, model.predict(X))
+        if expected.shape != predicted.shape:
+            err = f"Mismatched output shapes: {expected.shape} and {predicted.shape}"
+            raise ValueError(err)
+        if not expected.size:
+            continue
+        diff = numpy.abs(expected - predicted)
+        max_diff = max(max_diff, float(diff.max()))
+        total_diff += float(diff.sum())
+        n_values += diff.size
+        agree = expected.argmax(axis=-1) == predicted.argmax(axis=-1)
+        n_agree += int(agree.sum())
+        n_rows += agree.size
+    return {
+        "max_abs_diff": max_diff,
+        "mean_abs_diff": total_diff / max(n_values, 1),
+        "argmax_agreement": n_agree / max(n_rows, 1),
+    }
+
+
+def _calibrate(
+    model: Model, nodes: List[Model], batches: Iterable[Any], percentile: float
+) -> Dict[int, float]:
+    """Run the model on the batches, recording the largest absolute value of
+    each row of input to the nodes, and return a fixed input scale per node.
+    """
+    row_maxes: Dict[int, List[numpy.ndarray]] = {node.id: [] for node in nodes}
+    forwards = {node.id: node._func for node in nodes}
+
+    def record_forward(node: Model, X: Floats2d, is_train: bool) -> Any:
+        if X.size:
+            row_maxes[node.id].append(node.ops.to_numpy(abs(X).max(axis=1)))
+        return forwards[node.id](node, X, is_train)
+
+    for node in nodes:
+        node._func = record_forward
+    try:
+        for X in batches:
+            model.predict(X)
+    finally:
+        for node in nodes:
+            node._func = forwards[node.id]
+    input_scales = {}
+    for node_id, maxes in row_maxes.items():
+        if maxes:
+            limit = float(numpy.percentile(numpy.concatenate(maxes), percentile))
+            if limit > 0:
+                input_scales[node_id] = limit / 127.0
+    return input_scales
+
+
+def _get_output_array(model: Model, Y: Any) -> numpy.ndarray:
+    if isinstance(Y, (Ragged, Padded)):
+        Y = Y.data
+    elif isinstance(Y, (list, tuple)):
+        Y = model.ops.flatten(list(Y))
+    return numpy.asarray(model.ops.to_numpy(Y), dtype="float32")
@@ -0,0 +1,191 @@
+from typing import Any, Dict, List, Optional, Sequence, Tuple
+from collections import Counter
+from concurrent.futures import Future
+import asyncio
+import queue
+import threading
+import time
+
+from .model import Model
+from .types import Ragged
+
+
+_STOP = object()
+
+
+class BatchingExecutor:
+    """Serve predictions from a model to many callers in the same process,
+    coalescing the individual inputs into batches so that a single call to
+    `model.predict` handles them all. A batch is run as soon as it has
+    `max_batch_size` inputs, or when `max_latency` seconds have passed since
+    its first input arrived, whichever comes first.
+
+    The `batch_type` controls how the inputs are combined, following the
+    conventions of `with_array`:
+
+    - "list": Each input is one item, and the model is called with a list of
+      them. The model must return a list (or array) with one entry per item.
+    - "array": Each input is a 2d array, and the model is called with their
+      rows concatenated. Each caller gets back its own rows of the output.
+    - "ragged": Each input is a 2d array holding one sequence, and the model is
+      called with a Ragged of all the sequences. Each caller gets back the data
+      of its own sequence in the output.
+
+    Inputs can be submitted from any thread with `submit` or `predict`, or
+    awaited from asyncio tasks with `apredict`. The model only ever runs in
+    the executor's own thread.
+
+    EXAMPLE:
+        with BatchingExecutor(model, max_batch_size=32, max_latency=0.002) as executor:
+            Y = executor.predict(X)
+    """
+
+    def __init__(
+        self,
+        model: Model,
+        *,
+        max_batch_size: int = 64,
+        max_latency: float = 0.005,
+        batch_type: str = "list",
+    ):
+        if max_batch_size < 1:
+            raise ValueError(f"Invalid max_batch_size: {max_batch_size}")
+        if max_latency < 0:
+            raise ValueError(f"Invalid max_latency: {max_latency}")
+        if batch_type not in ("list", "array", "ragged"):
+            raise ValueError(f"Invalid batch_type: {batch_type}")
+        self.model = model
+        self.max_batch_size = max_batch_size
+        self.max_latency = max_latency
+        self.batch_type = batch_type
+        self.queue_depths: Counter = Counter()
+        self.batch_sizes: Counter = Counter()
+        self._queue: queue.Queue = queue.Queue()
+        self._lock = threading.Lock()
+        self._closed = False
+        self._thread = threading.Thread(target=self._work, daemon=True)
+        self._thread.start()
+
+    def __enter__(self) -> "BatchingExecutor":
+        return self
+
+    def __exit__(self, *args) -> None:
+        self.close()
+
+    def submit(self, X: Any) -> Future:
+        """Queue an input, and return a future for its prediction."""
+        future: Future = Future()
+        with self._lock:
+            if self._closed:
+                raise ValueError("Cannot submit: the executor has been closed")
+            self._queue.put((X, future))
+        return future
+
+    def predict(self, X: Any) -> Any:
+        """Queue an input, and block until its prediction is ready."""
+        return self.submit(X).result()
+
+    async def apredict(self, X: Any) -> Any:
+        """Queue an input, and await its prediction."""
+        return await asyncio.wrap_future(self.submit(X))
+
+    def get_histograms(self) -> Dict[str, Dict[int, int]]:
+        """Get histograms of the number of inputs waiting in the queue when a
+        batch is started, and of the sizes of the batches that were run.
+        """
+        with self._lock:
+            return {
+                "queue_depth": dict(sorted(self.queue_depths.items())),
+                "batch_size": dict(sorted(self.batch_sizes.items())),
+            }
+
+    def close(self) -> None:
+        """Stop accepting inputs, finish the queued ones and stop the thread."""
+        with self._lock:
+            if self._closed:
+                return
+            self._closed = True
+            self._queue.put(_STOP)
+        self._thread.join()
+
+    def _work(self) -> None:
+        while True:
+            item = self._queue.get()
+            if item is _STOP:
+                break
+            batch = [item]
+            depth = self._queue.qsize() + 1
+            deadline = time.monotonic() + self.max_latency
+            stop = False
+            while len(batch) < self.max_batch_size:
+                timeout = deadline - time.monotonic()
+                try:
+                    if timeout > 0:
+                        item = self._queue.get(timeout=timeout)
+                    else:
+                        item = self._queue.get_nowait()
+                except queue.Empty:
+                    break
+                if item is _STOP:
+                    stop = True
+                    break
+                batch.append(item)
+            with self._lock:
+                self.queue_depths[depth] += 1
+                self.batch_sizes[len(batch)] += 1
+            self._run_batch(batch)
+            if stop:
+                break
+        # Fail anything that was queued after the stop signal.
+        while not self._queue.empty():  # pragma: no cover
+            item = self._queue.get_nowait()
+            if item is not _STOP:
+                item[1].set_exception(ValueError("The executor has been closed"))
+
+    def _run_batch(self, batch: List[Tuple[Any, Future]]) -> None:
+        # Move every future to RUNNING, so clients can't cancel them while the
+        # batch is predicted, and drop the ones that were cancelled already.
+        running = [future.set_running_or_notify_cancel() for _, future in batch]
+        batch = [item for item, is_running in zip(batch, running) if is_running]
+        if not batch:
+            return
+        futures = [future for _, future in batch]
+        try:
+            Xs = [X for X, _ in batch]
+            Y = self.model.predict(self._combine(Xs))
+            results = self._split(Y, Xs)
+        except Exception as e:
+            for future in futures:
+                future.set_exception(e)
+        else:
+            for future, result in zip(futures, results):
+                future.set_result(result)
+
+    def _combine(self, Xs: List[Any]) -> Any:
+        ops = self.model.ops
+        if self.batch_type == "list":
+            return Xs
+        elif self.batch_type == "array":
+            return ops.xp.concatenate(Xs, axis=0)
+        else:
+            lengths = ops.asarray1i([len(X) for X in Xs])
+            return Ragged(ops.xp.concatenate(Xs, axis=0), lengths)
+
+    def _split(self, Y: Any, Xs: List[Any]) -> Sequence[Any]:
+        if self.batch_type == "ragged":
+            if not isinstance(Y, Ragged) or len(Y) != len(Xs):
+                raise ValueError("Expected the model to return a Ragged batch")
+            return [Y[i].dataXd for i in range(len(Xs))]
+        elif self.batch_type == "array":
+            sizes = [len(X) for X in Xs]
+            if len(Y) != sum(sizes):
+                raise ValueError(f"Mismatched output rows: {len(Y)} vs {sum(sizes)}")
+            starts = [sum(sizes[:i]) for i in range(len(sizes))]
+            return [Y[start : start + size] for start, size in zip(starts, sizes)]
+        else:
+            if len(Y) != len(Xs):
+                raise ValueError(f"Mismatched output items: {len(Y)} vs {len(Xs)}")
+            return [Y[i] for i in range(len(Xs))]
+
+
+__all__ = ["BatchingExecutor"]
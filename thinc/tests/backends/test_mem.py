@@ -1,4 +1,6 @@
 from thinc.backends._param_server import ParamServer
+from thinc.api import track_memory, chain, Relu
+import pytest
 import numpy
 
 
@@ -9,3 +11,43 @@ def test_param_server_init():
     ps = ParamServer(params, grads)
     assert ps.param_keys == (("a", 1), ("b", 2))
     assert ps.grad_keys == (("a", 1),)
+
+
+def test_track_memory():
+    model = chain(Relu(64, 32, dropout=0.2), Relu(16, 64))
+    model.initialize()
+    X = model.ops.alloc2f(128, 32)
+    with track_memory() as tracker:
+        with pytest.raises(ValueError):
+            with track_memory():
+                pass
+        Y, backprop = model.begin_update(X)
+        dX = backprop(Y)
+        stats = tracker.step()
+        assert stats["peak_bytes"] >= stats["live_bytes"] > 0
+        assert stats["n_allocs"] > 0
+        nodes = [name for name, _ in stats["allocated_by_node"]]
+        assert "dropout" in nodes
+        assert all(n_bytes > 0 for _, n_bytes in stats["peak_by_node"])
+        live = tracker.live_bytes
+        del Y, backprop, dX
+        assert tracker.live_bytes < live
+        array = model.ops.alloc1f(10)
+        assert tracker.step()["allocated_by_node"] == [("<no node>", 40)]
+        assert "Peak" in tracker.format_table()
+    model.ops.alloc1f(10)
+    assert tracker.steps[-1]["n_allocs"] == 1
+    assert array.shape == (10,)
+
+
+def test_param_server_remove_param():
+    ps = ParamServer()
+    ps.set_param(1, "W", numpy.ones((2, 3), dtype="f"))
+    ps.set_grad(1, "W", numpy.zeros((2, 3), dtype="f"))
+    ps.get_packed_param(1, "W", lambda W: W.T.copy())
+    version = ps.get_version(1, "W")
+    ps.remove_param(1, "W")
+    assert not ps.has_param(1, "W")
+    assert not ps.has_grad(1, "W")
+    assert (1, "W") not in ps._packed
+    assert ps.get_version(1, "W") > version
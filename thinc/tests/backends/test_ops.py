@@ -178,6 +178,164 @@ def test_backprop_seq2col_window_one(ops, X):
     ops.xp.testing.assert_allclose(target, predicted, atol=0.001, rtol=0.001)
 
 
+@pytest.mark.parametrize("ops", ALL_OPS)
+@pytest.mark.parametrize("nW", [1, 2, 3])
+def test_seq2col_lengths(ops, nW):
+    lengths = ops.asarray1i([3, 0, 1, 4])
+    X = ops.asarray(numpy.random.uniform(-1, 1, (8, 2)).astype("f"))
+    starts = [0, 3, 3, 4, 8]
+    docs = [X[start:end] for start, end in zip(starts, starts[1:]) if end > start]
+    expected = ops.xp.vstack([ops.seq2col(doc, nW) for doc in docs])
+    cols = ops.seq2col(X, nW, lengths=lengths)
+    ops.xp.testing.assert_allclose(cols, expected)
+    assert_allclose(cols[0, : 2 * nW], numpy.zeros((2 * nW,), dtype="f"))
+    dY = ops.asarray(numpy.random.uniform(-1, 1, cols.shape).astype("f"))
+    d_docs = [dY[start:end] for start, end in zip(starts, starts[1:]) if end > start]
+    expected_dX = ops.xp.vstack([ops.backprop_seq2col(d, nW) for d in d_docs])
+    dX = ops.backprop_seq2col(dY, nW, lengths=lengths)
+    ops.xp.testing.assert_allclose(dX, expected_dX, rtol=1e-5, atol=1e-6)
+    with pytest.raises(ValueError):
+        ops.seq2col(X, nW, lengths=ops.asarray1i([3, 4]))
+
+
+@pytest.mark.parametrize("ops", ALL_OPS)
+@pytest.mark.parametrize("nW", [0, 1, 2])
+@pytest.mark.parametrize("lengths", [None, [3, 0, 1, 4]])
+def test_window_gemm(ops, nW, lengths):
+    nF = nW * 2 + 1
+    if lengths is not None:
+        lengths = ops.asarray1i(lengths)
+    X = ops.asarray(numpy.random.uniform(-1, 1, (8, 3)).astype("f"))
+    W = ops.asarray(numpy.random.uniform(-1, 1, (5, nF * 3)).astype("f"))
+    dY = ops.asarray(numpy.random.uniform(-1, 1, (8, 5)).astype("f"))
+    cols = ops.seq2col(X, nW, lengths=lengths)
+    Y = ops.window_gemm(X, W, nW, lengths=lengths)
+    expected_Y = ops.gemm(cols, W, trans2=True)
+    ops.xp.testing.assert_allclose(Y, expected_Y, rtol=1e-5, atol=1e-6)
+    dX, dW = ops.backprop_window_gemm(dY, X, W, nW, lengths=lengths)
+    expected_dX = ops.backprop_seq2col(ops.gemm(dY, W), nW, lengths=lengths)
+    expected_dW = ops.gemm(dY, cols, trans1=True)
+    ops.xp.testing.assert_allclose(dX, expected_dX, rtol=1e-5, atol=1e-6)
+    ops.xp.testing.assert_allclose(dW, expected_dW, rtol=1e-5, atol=1e-6)
+    # Packed weights give the same results.
+    packed = ops.pack_window_weights(W, nW)
+    ops.xp.testing.assert_allclose(ops.window_gemm(X, packed, nW, lengths=lengths), Y)
+    packed_dX, packed_dW = ops.backprop_window_gemm(dY, X, packed, nW, lengths=lengths)
+    ops.xp.testing.assert_allclose(packed_dX, dX)
+    ops.xp.testing.assert_allclose(packed_dW, dW)
+
+
+@pytest.mark.parametrize("ops", ALL_OPS)
+@pytest.mark.parametrize("rate", [0.0, 0.25, 0.5, 1.0])
+def test_dropout(ops, rate):
+    X = ops.asarray(numpy.random.uniform(1, 2, (50, 40)).astype("f"))
+    Y = ops.dropout(X, rate, seed=1234)
+    kept = ops.to_numpy(Y) != 0
+    assert abs(kept.mean() - (1 - rate)) < 0.05
+    if rate < 1:
+        expected_kept = ops.to_numpy(X)[kept] / (1 - rate)
+        assert_allclose(ops.to_numpy(Y)[kept], expected_kept, rtol=1e-6)
+    # The same seed regenerates the mask for the backward pass.
+    dX = ops.backprop_dropout(ops.xp.ones_like(X), rate, seed=1234)
+    assert_allclose(ops.to_numpy(dX) != 0, kept)
+    # The masks don't depend on the backend.
+    expected = VANILLA_OPS.dropout(ops.to_numpy(X), rate, seed=1234)
+    assert_allclose(ops.to_numpy(Y), expected, rtol=1e-6)
+    if 0 < rate < 1:
+        other = ops.to_numpy(ops.dropout(X, rate, seed=4321)) != 0
+        assert (other != kept).any()
+
+
+@pytest.mark.parametrize("ops", ALL_OPS)
+def test_layer_norm(ops):
+    X = numpy.random.uniform(-1, 1, (6, 5)).astype("f") + 3.0
+    G = numpy.random.uniform(0.5, 1.5, (5,)).astype("f")
+    b = numpy.random.uniform(-1, 1, (5,)).astype("f")
+    dY = numpy.random.uniform(-1, 1, (6, 5)).astype("f")
+    # Reference values with the textbook formulas, in double precision.
+    X64 = X.astype("float64")
+    dist = X64 - X64.mean(axis=1, keepdims=True)
+    var = X64.var(axis=1, keepdims=True) + 1e-8
+    Xhat = dist * var ** -0.5
+    g = dY * G
+    N = X.shape[1]
+    expected_dX = N * g - g.sum(axis=1, keepdims=True)
+    expected_dX -= dist / var * (g * dist).sum(axis=1, keepdims=True)
+    expected_dX *= var ** -0.5 / N
+    Y, mean, inv_std = ops.layer_norm(ops.asarray(X), ops.asarray(G), ops.asarray(b))
+    assert_allclose(ops.to_numpy(Y), Xhat * G + b, rtol=1e-4, atol=1e-5)
+    dX, dG, db = ops.backprop_layer_norm(
+        ops.asarray(dY), ops.asarray(X), ops.asarray(G), mean, inv_std
+    )
+    assert_allclose(ops.to_numpy(dX), expected_dX, rtol=1e-4, atol=1e-5)
+    assert_allclose(ops.to_numpy(dG), (dY * Xhat).sum(axis=0), rtol=1e-4, atol=1e-5)
+    assert_allclose(ops.to_numpy(db), dY.sum(axis=0), rtol=1e-4, atol=1e-5)
+
+
+@pytest.mark.parametrize("ops", ALL_OPS)
+def test_softmax_cross_entropy(ops):
+    logits = numpy.random.uniform(-50, 50, (6, 4)).astype("f")
+    targets = numpy.asarray([0, 3, 1, 1, 2, 0], dtype="i")
+    d_logits, losses = ops.softmax_cross_entropy(
+        ops.asarray(logits), ops.asarray1i(targets)
+    )
+    probs = VANILLA_OPS.softmax(logits.astype("float64"))
+    expected_d_logits = probs.copy()
+    expected_d_logits[numpy.arange(6), targets] -= 1
+    log_probs = logits - logits.max(axis=1, keepdims=True)
+    log_probs -= numpy.log(numpy.exp(log_probs).sum(axis=1, keepdims=True))
+    expected_losses = -log_probs[numpy.arange(6), targets]
+    assert_allclose(ops.to_numpy(d_logits), expected_d_logits, rtol=1e-5, atol=1e-6)
+    assert_allclose(ops.to_numpy(losses), expected_losses, rtol=1e-5, atol=1e-5)
+    with pytest.raises(ValueError):
+        ops.softmax_cross_entropy(ops.asarray(logits), ops.asarray1i(targets + 1))
+    with pytest.raises(ValueError):
+        ops.softmax_cross_entropy(ops.asarray(logits), ops.asarray1i(targets[:3]))
+
+
+@pytest.mark.parametrize("ops", XP_OPS)
+def test_softmax_sequences(ops):
+    lengths = [3, 0, 1, 4]
+    X = numpy.random.uniform(-30, 30, (8, 2)).astype("f")
+    dY = numpy.random.uniform(-1, 1, (8, 2)).astype("f")
+    Y = ops.softmax_sequences(ops.asarray(X), ops.asarray1i(lengths))
+    dX = ops.backprop_softmax_sequences(
+        ops.asarray(dY), Y, ops.asarray1i(lengths)
+    )
+    lengths = VANILLA_OPS.asarray1i(lengths)
+    expected_Y = VANILLA_OPS.softmax_sequences(X, lengths)
+    expected_dX = VANILLA_OPS.backprop_softmax_sequences(dY, expected_Y, lengths)
+    assert_allclose(ops.to_numpy(Y), expected_Y, rtol=1e-5, atol=1e-6)
+    assert_allclose(ops.to_numpy(dX), expected_dX, rtol=1e-5, atol=1e-6)
+
+
+@pytest.mark.parametrize("ops", XP_OPS)
+def test_parametric_attention(ops):
+    lengths = [3, 0, 1, 4]
+    X = numpy.random.uniform(-1, 1, (8, 5)).astype("f")
+    Q = numpy.random.uniform(-1, 1, (5,)).astype("f")
+    dY = numpy.random.uniform(-1, 1, (8, 5)).astype("f")
+    Y, attention = ops.parametric_attention(
+        ops.asarray(X), ops.asarray(Q), ops.asarray1i(lengths)
+    )
+    dX, dQ = ops.backprop_parametric_attention(
+        ops.asarray(dY),
+        ops.asarray(X),
+        ops.asarray(Q),
+        attention,
+        ops.asarray1i(lengths),
+    )
+    lengths = VANILLA_OPS.asarray1i(lengths)
+    expected_Y, expected_attention = VANILLA_OPS.parametric_attention(X, Q, lengths)
+    expected_dX, expected_dQ = VANILLA_OPS.backprop_parametric_attention(
+        dY, X, Q, expected_attention, lengths
+    )
+    assert_allclose(ops.to_numpy(attention), expected_attention, rtol=1e-5)
+    assert_allclose(ops.to_numpy(Y), expected_Y, rtol=1e-5, atol=1e-6)
+    assert_allclose(ops.to_numpy(dX), expected_dX, rtol=1e-5, atol=1e-6)
+    assert_allclose(ops.to_numpy(dQ), expected_dQ, rtol=1e-5, atol=1e-6)
+
+
 @pytest.mark.parametrize("ops", XP_OPS)
 def test_seq2col_window_two(ops):
     seq = ops.asarray([[1.0], [2.0], [3.0], [4]], dtype="float32")
@@ -274,6 +432,17 @@ def test_gemm_computes_correctly(cpu_ops):
     cpu_ops.gemm(X, W, trans1=True, out=Y)
 
 
+@pytest.mark.parametrize("cpu_ops", [NUMPY_OPS, VANILLA_OPS, BLIS_OPS])
+def test_gemm_strided_out(cpu_ops):
+    X = numpy.random.uniform(size=(4, 2)).astype("f")
+    W = numpy.random.uniform(size=(3, 2)).astype("f")
+    output = numpy.zeros((4, 7), dtype="f")
+    Y = cpu_ops.gemm(X, W, trans2=True, out=output[:, 2:5])
+    assert numpy.shares_memory(Y, output)
+    assert_allclose(output[:, 2:5], numpy.dot(X, W.T), atol=1e-4, rtol=1e-4)
+    assert not output[:, :2].any() and not output[:, 5:].any()
+
+
 @pytest.mark.parametrize("cpu_ops", CPU_OPS)
 @settings(max_examples=MAX_EXAMPLES, deadline=None)
 @given(X=strategies.arrays_BI())
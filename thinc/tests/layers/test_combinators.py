@@ -1,8 +1,9 @@
 import pytest
 import numpy
 from thinc.api import clone, concatenate, noop, add
-from thinc.api import Linear, Dropout, Model, NumpyOps
+from thinc.api import Linear, Dropout, Model, NumpyOps, HashEmbed, Relu
 from thinc.layers import chain
+from thinc.model import use_output_buffer
 
 
 @pytest.fixture(params=[1, 2, 9])
@@ -208,6 +209,24 @@ def test_add_edge_cases():
     assert numpy.array_equal(dX, data)
 
 
+@pytest.mark.parametrize("first", [noop(), Dropout(0.0)])
+def test_add_doesnt_modify_input(first):
+    data = numpy.asarray([[1, 2, 3, 4]], dtype="f")
+    linear = Linear(4, 4)
+    linear.initialize()
+    model = add(first, linear, noop())
+    X = data.copy()
+    Y = model.predict(X)
+    assert numpy.array_equal(X, data)
+    numpy.testing.assert_allclose(Y, data * 2 + linear.predict(data), rtol=1e-6)
+    Y, backprop = model.begin_update(X)
+    assert numpy.array_equal(X, data)
+    dY = numpy.ones_like(Y)
+    dX = backprop(dY)
+    assert numpy.array_equal(dY, numpy.ones_like(Y))
+    assert dX.shape == data.shape
+
+
 def test_concatenate():
     data = numpy.asarray([[1, 2, 3], [4, 5, 6]], dtype="f")
     model = concatenate(Linear(), Linear())
@@ -216,3 +235,111 @@ def test_concatenate():
     assert Y.shape[1] == sum([layer.predict(data).shape[1] for layer in model.layers])
     dX = backprop(Y)
     assert dX.shape == data.shape
+
+
+def test_concatenate_branches_can_write_gradients():
+    data = numpy.asarray([[1, 2, 3], [4, 5, 6]], dtype="f")
+
+    def forward(model, X, is_train):
+        def backprop(dY):
+            dY *= 2
+            return dY
+
+        return X, backprop
+
+    linear = Linear(3, 3)
+    linear.initialize()
+    model = concatenate(
+        Model("double", forward), add(noop(), linear), Model("double", forward)
+    )
+    Y, backprop = model(data, is_train=True)
+    numpy.testing.assert_allclose(
+        Y, numpy.hstack([data, data + linear.predict(data), data]), rtol=1e-6
+    )
+    dY = numpy.arange(18, dtype="f").reshape((2, 9))
+    d_output = dY.copy()
+    dX = backprop(d_output)
+    # The caller's gradient and the other branches' blocks aren't modified.
+    numpy.testing.assert_equal(d_output, dY)
+    dY_add = dY[:, 3:6]
+    expected = dY[:, :3] * 2 + dY_add + dY_add @ linear.get_param("W") + dY[:, 6:] * 2
+    numpy.testing.assert_allclose(dX, expected, rtol=1e-5)
+
+
+def test_output_buffer():
+    data = numpy.random.uniform(-1, 1, (5, 3)).astype("f")
+    output = numpy.zeros((5, 7), dtype="f")
+    linear = Linear(4, 3)
+    linear.initialize()
+    with use_output_buffer(linear, output[:, 1:5]):
+        Y, _ = linear(data, is_train=True)
+    assert numpy.shares_memory(Y, output)
+    numpy.testing.assert_allclose(output[:, 1:5], linear.predict(data), rtol=1e-5)
+    # A chain passes the buffer on to its last layer, other layers ignore it.
+    model = chain(Relu(3, 3), Linear(4, 3))
+    model.initialize()
+    with use_output_buffer(model, output[:, 1:5]):
+        assert numpy.shares_memory(model.predict(data), output)
+    relu = Relu(4, 3)
+    relu.initialize()
+    with use_output_buffer(relu, output[:, 1:5]):
+        assert not numpy.shares_memory(relu.predict(data), output)
+
+
+def test_concatenate_writes_into_output():
+    data = numpy.random.uniform(-1, 1, (5, 3)).astype("f")
+    ids = numpy.asarray([[1, 4], [2, 5], [3, 6], [4, 7], [5, 8]], dtype="uint64")
+    branches = [Linear(4, 3), Relu(2, 3), chain(Relu(3, 3), Linear(5, 3))]
+    model = concatenate(*branches)
+    model.initialize()
+    Y, backprop = model(data, is_train=True)
+    expected = numpy.hstack([layer.predict(data) for layer in branches])
+    numpy.testing.assert_allclose(Y, expected, rtol=1e-5)
+    dY = numpy.random.uniform(-1, 1, Y.shape).astype("f")
+    d_output = dY.copy()
+    dX = backprop(d_output)
+    numpy.testing.assert_equal(d_output, dY)
+    expected_dX = 0
+    start = 0
+    for layer in branches:
+        width = layer.get_dim("nO")
+        expected_dX += layer(data, is_train=True)[1](dY[:, start : start + width])
+        start += width
+    numpy.testing.assert_allclose(dX, expected_dX, rtol=1e-4, atol=1e-6)
+    # Integer inputs and a chain ending in HashEmbed.
+    model = concatenate(HashEmbed(4, 10, column=0), HashEmbed(3, 10, column=1))
+    model.initialize()
+    Y = model.predict(ids)
+    numpy.testing.assert_allclose(
+        Y, numpy.hstack([layer.predict(ids) for layer in model.layers]), rtol=1e-6
+    )
+
+
+def test_concatenate_parallel():
+    data = numpy.random.uniform(-1, 1, (5, 3)).astype("f")
+    model = concatenate(Linear(4, 3), Linear(2, 3), Linear(3, 3))
+    model.initialize()
+    parallel = concatenate(*[layer.copy() for layer in model.layers], parallel=True)
+    for layer, other in zip(model.layers, parallel.layers):
+        for name in layer.param_names:
+            other.set_param(name, layer.get_param(name).copy())
+    Y, backprop = model(data, is_train=True)
+    Yp, backprop_p = parallel(data, is_train=True)
+    numpy.testing.assert_allclose(Yp, Y)
+    numpy.testing.assert_allclose(backprop_p(Y), backprop(Y))
+    numpy.testing.assert_allclose(parallel.predict(data), model.predict(data))
+
+
+def test_concatenate_list():
+    data = [
+        numpy.asarray([[1, 2, 3], [4, 5, 6]], dtype="f"),
+        numpy.asarray([[7, 8, 9]], dtype="f"),
+    ]
+    model = concatenate(noop(), noop())
+    Ys, backprop = model(data, is_train=True)
+    assert len(Ys) == 2
+    for X, Y in zip(data, Ys):
+        numpy.testing.assert_equal(Y, numpy.hstack([X, X]))
+    dXs = backprop(Ys)
+    for X, dX in zip(data, dXs):
+        numpy.testing.assert_equal(dX, X * 2)
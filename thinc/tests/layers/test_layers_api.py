@@ -72,6 +72,10 @@ TEST_CASES_SUMMABLE = [
     ("Relu.v1", {"normalize": True, "dropout": 0.2}, array2d, array2d),
     ("Softmax.v1", {}, array2d, array2d),
     ("Softmax.v1", {"nO": 4, "nI": 4}, array2d, array2d),
+    ("Softmax.v1", {"normalize_outputs": False}, array2d, array2d),
+    ("WindowedMaxout.v1", {}, array2d, array2d),
+    ("WindowedMaxout.v1", {"normalize": True, "dropout": 0.2}, array2d, array2d),
+    ("WindowedMaxout.v1", {"window_size": 2}, ragged, ragged),
     # fmt: off
     # List to list
     ("LSTM.v1", {"bi": False}, [array2d, array2d], [array2d, array2d]),
@@ -103,6 +107,7 @@ TEST_CASES = [
     # fmt: off
     # Other
     ("expand_window.v1", {}, array2d, array2d),
+    ("expand_window.v1", {}, ragged, ragged),
     ("Embed.v1", {"nO": 4, "nV": array2dint.max() + 1, "column": 0}, array2dint, array2d),
     ("Embed.v1", {"nO": 4, "nV": array1dint.max() + 1}, array1dint, array2d),
     ("HashEmbed.v1", {"nO": 1, "nV": array2dint.max(), "column": 0}, array2dint, array2d),
@@ -0,0 +1,26 @@
+import numpy
+from numpy.testing import assert_allclose
+from thinc.api import StaticVectors
+
+
+def test_static_vectors_projection_cache():
+    vectors = numpy.random.uniform(-1, 1, (10, 4)).astype("f")
+    model = StaticVectors(3, vectors).initialize()
+    ids = numpy.asarray([1, 2, 1, 12, 9], dtype="i")
+    Y, backprop = model(ids, is_train=True)
+    assert_allclose(model.predict(ids), Y, rtol=1e-5, atol=1e-6)
+    # Only the rows that were used are projected.
+    cache = model.get_packed_param("W", dict)
+    assert cache["size"] == 4
+    assert (cache["slots"] >= 0).tolist() == [i in (0, 1, 2, 9) for i in range(10)]
+    # New rows are added to the table as they're used.
+    more_ids = numpy.asarray([3, 2, 8, 3], dtype="i")
+    expected, _ = model(more_ids, is_train=True)
+    assert_allclose(model.predict(more_ids), expected, rtol=1e-5, atol=1e-6)
+    assert cache["size"] == 6
+    # Setting the parameters of another model keeps the cache.
+    StaticVectors(3, vectors).initialize().set_param("W", model.get_param("W"))
+    assert model.get_packed_param("W", dict) is cache
+    # Setting the weights invalidates it.
+    model.set_param("W", model.get_param("W") * 2)
+    assert_allclose(model.predict(ids), Y * 2, rtol=1e-5, atol=1e-6)
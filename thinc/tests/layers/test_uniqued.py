@@ -1,6 +1,6 @@
 import pytest
 import numpy
-from thinc.layers import Embed
+from thinc.api import Embed, NumpyOps, Ops, Model, chain, with_checkpoint
 from ...layers.uniqued import uniqued
 from numpy.testing import assert_allclose
 from hypothesis import given
@@ -60,3 +60,66 @@ def test_uniqued_doesnt_change_result(model, X):
         # Z, bp_Z = model(X + 1, is_train=True)
         # with pytest.raises(AssertionError):
         #    assert_allclose(Y, Z)
+
+
+def test_unique_keys():
+    ops = NumpyOps()
+    keys = numpy.asarray([5, 3, 5, 0, 1, 3, 5], dtype="uint64")
+    ind, inv, counts = ops.unique_keys(keys)
+    assert ind.tolist() == [0, 1, 3, 4]
+    assert inv.tolist() == [0, 1, 0, 2, 3, 1, 0]
+    assert counts.tolist() == [3, 2, 1, 1]
+    ind, inv, counts = Ops().unique_keys(keys)
+    assert inv.tolist() == [0, 1, 0, 2, 3, 1, 0]
+
+
+def test_uniqued_cache(model):
+    umodel = uniqued(model, column=0, cache_size=4).initialize()
+    cache = umodel.attrs["cache"]
+    X1 = numpy.asarray([[1, 0], [2, 0], [1, 0]], dtype="uint64")
+    X2 = numpy.asarray([[3, 0], [1, 0], [3, 0]], dtype="uint64")
+    X3 = numpy.asarray([[4, 0], [5, 0], [4, 0]], dtype="uint64")
+    for X in (X1, X2, X3):
+        assert_allclose(umodel.predict(X), model.predict(X))
+    # The key 2 was used least recently, so it was evicted.
+    assert set(cache.slots) == {1, 3, 4, 5}
+    assert_allclose(umodel.predict(X1), model.predict(X1))
+    assert set(cache.slots) == {1, 2, 4, 5}
+    # Training doesn't use the cache, and setting a parameter of another
+    # model doesn't clear it.
+    umodel.begin_update(X3)
+    assert set(cache.slots) == {1, 2, 4, 5}
+    other = Embed(4, ROWS).initialize()
+    other.set_param("E", other.get_param("E") + 1)
+    assert_allclose(umodel.predict(X1), model.predict(X1))
+    assert set(cache.slots) == {1, 2, 4, 5}
+    # Setting a parameter of the wrapped layer clears it.
+    embed = model.layers[-1]
+    embed.set_param("E", embed.get_param("E") + 1)
+    assert_allclose(umodel.predict(X2), model.predict(X2))
+    assert set(cache.slots) == {1, 3}
+
+
+
+
+def test_uniqued_cache_with_checkpoint():
+    def forward(model, X, is_train):
+        return X + 1 if is_train else X, lambda dY: dY
+
+    layer = chain(Embed(4, ROWS, column=0), Model("train-only", forward))
+    umodel = uniqued(layer, column=0, cache_size=8)
+    model = with_checkpoint(umodel).initialize()
+    cache = umodel.attrs["cache"]
+    X = numpy.asarray([[1, 0], [2, 0], [1, 0], [3, 0]], dtype="uint64")
+    expected = layer.predict(X)
+    # with_checkpoint runs the training forward under no_grad(), which
+    # mustn't fill the inference cache...
+    Y, backprop = model.begin_update(X)
+    assert_allclose(Y, expected + 1)
+    assert not cache.slots
+    assert_allclose(model.predict(X), expected)
+    assert set(cache.slots) == {1, 2, 3}
+    # ...or read the outputs cached at inference.
+    Y, backprop = model.begin_update(X)
+    assert_allclose(Y, expected + 1)
+    assert backprop(numpy.ones_like(Y)).shape == X.shape
@@ -0,0 +1,22 @@
+import numpy
+from numpy.testing import assert_allclose
+from thinc.api import WindowedMaxout, Maxout, expand_window, chain
+
+
+def test_windowed_maxout_matches_expand_window_maxout():
+    X = numpy.random.uniform(-1, 1, (7, 4)).astype("f")
+    dY = numpy.random.uniform(-1, 1, (7, 6)).astype("f")
+    fused = WindowedMaxout(6, 4, nP=3, window_size=2).initialize(X=X)
+    model = chain(expand_window(window_size=2), Maxout(6, 20, nP=3))
+    model.initialize(X=X)
+    maxout = model.layers[1]
+    maxout.set_param("W", fused.get_param("W").copy())
+    maxout.set_param("b", fused.get_param("b").copy())
+    Y, backprop = fused(X, is_train=True)
+    expected_Y, expected_backprop = model(X, is_train=True)
+    assert_allclose(Y, expected_Y, rtol=1e-5, atol=1e-6)
+    assert_allclose(backprop(dY), expected_backprop(dY), rtol=1e-5, atol=1e-6)
+    for name in ("W", "b"):
+        assert_allclose(
+            fused.get_grad(name), maxout.get_grad(name), rtol=1e-5, atol=1e-6
+        )
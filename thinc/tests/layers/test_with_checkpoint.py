@@ -0,0 +1,103 @@
+import numpy
+from numpy.testing import assert_allclose
+from thinc.api import with_checkpoint, chain, Relu, Dropout, Softmax, registry
+from thinc.api import Config, NumpyOps
+
+
+def _make_model():
+    return chain(Relu(8, 4, dropout=0.5), Relu(8, 8), Dropout(0.2), Softmax(3, 8))
+
+
+def test_with_checkpoint_matches_gradients():
+    X = numpy.random.uniform(-1, 1, (5, 4)).astype("f")
+    dY = numpy.random.uniform(-1, 1, (5, 3)).astype("f")
+    plain = _make_model()
+    plain.initialize()
+    model = with_checkpoint(_make_model())
+    model.initialize()
+    for node, plain_node in zip(model.layers[0].walk(), plain.walk()):
+        for name in plain_node.param_names:
+            node.set_param(name, plain_node.get_param(name).copy())
+    state = numpy.random.get_state()
+    Y, backprop = plain(X, is_train=True)
+    dX = backprop(dY)
+    numpy.random.set_state(state)
+    Yc, backprop_checkpoint = model(X, is_train=True)
+    # Draws made between the forward and backward pass shouldn't matter.
+    numpy.random.uniform(0, 1, (10,))
+    dXc = backprop_checkpoint(dY)
+    assert_allclose(Yc, Y, rtol=1e-5)
+    assert_allclose(dXc, dX, rtol=1e-5, atol=1e-6)
+    for node, plain_node in zip(model.layers[0].walk(), plain.walk()):
+        for name in plain_node.param_names:
+            if plain_node.has_grad(name):
+                assert_allclose(
+                    node.get_grad(name),
+                    plain_node.get_grad(name),
+                    rtol=1e-5,
+                    atol=1e-6,
+                )
+
+
+def test_with_checkpoint_from_config():
+    config_str = """
+    [model]
+    @layers = "with_checkpoint.v1"
+
+    [model.layer]
+    @layers = "Relu.v1"
+    nO = 4
+    nI = 2
+    """
+    config = Config().from_str(config_str)
+    model = registry.make_from_config(config)["model"]
+    model.initialize()
+    X = numpy.zeros((3, 2), dtype="f")
+    assert model.predict(X).shape == (3, 4)
+
+
+class _OtherXp:
+    """An array module with its own random generator, like cupy."""
+
+    random = numpy.random.RandomState(0)
+
+    def __getattr__(self, name):
+        return getattr(numpy, name)
+
+
+class _OtherXpOps(NumpyOps):
+    xp = _OtherXp()
+
+
+def test_with_checkpoint_other_xp():
+    X = numpy.random.uniform(-1, 1, (5, 4)).astype("f")
+    dY = numpy.random.uniform(-1, 1, (5, 3)).astype("f")
+    model = with_checkpoint(_make_model())
+    model.initialize()
+    ops = _OtherXpOps()
+    for node in model.walk():
+        node.ops = ops
+    state = numpy.random.get_state()
+    Y, backprop = model.layers[0](X, is_train=True)
+    dX = backprop(dY)
+    numpy.random.set_state(state)
+    Yc, backprop_checkpoint = model(X, is_train=True)
+    numpy.random.uniform(0, 1, (10,))
+    dXc = backprop_checkpoint(dY)
+    assert_allclose(Yc, Y, rtol=1e-5)
+    assert_allclose(dXc, dX, rtol=1e-5, atol=1e-6)
+
+
+
+def test_with_checkpoint_softmax_logits():
+    X = numpy.random.uniform(-1, 1, (5, 4)).astype("f")
+    model = with_checkpoint(Softmax(3, 4, normalize_outputs=False))
+    model.initialize()
+    softmax = model.layers[0]
+    W = numpy.random.uniform(-1, 1, (3, 4)).astype("f")
+    softmax.set_param("W", W)
+    # The training forward runs under no_grad(), and must still return logits.
+    Y, backprop = model(X, is_train=True)
+    assert_allclose(Y, X @ W.T, rtol=1e-5, atol=1e-6)
+    assert_allclose(backprop(Y), Y @ W, rtol=1e-5, atol=1e-6)
+    assert_allclose(model.predict(X).sum(axis=1), numpy.ones((5,)), rtol=1e-5)
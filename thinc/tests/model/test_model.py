@@ -1,4 +1,6 @@
 import pytest
+import copy
+import srsly
 import threading
 import time
 import ml_datasets
@@ -7,11 +9,14 @@ from thinc.api import (
     prefer_gpu,
     Linear,
     Dropout,
+    HashEmbed,
     Model,
     Shim,
     change_attr_values,
+    no_grad,
 )
-from thinc.api import set_dropout_rate, chain, Relu, Softmax, Adam
+from thinc.api import set_dropout_rate, chain, Relu, Softmax, Adam, SGD
+from thinc.api import Maxout, LayerNorm, concatenate, residual
 import numpy
 
 from ..util import make_tempdir
@@ -146,6 +151,54 @@ def test_model_set_reference():
     assert not parent.has_ref("grandkind")
 
 
+def test_param_index_tracks_structure_changes():
+    model = chain(Linear(2, 2), Linear(2, 2))
+    model.initialize()
+    child = model.layers[0]
+    slots = {(node.id, name) for node, name in model._get_index()[1]}
+    assert slots == {(node.id, name) for node in model.layers for name in "Wb"}
+    assert model._get_index()[1] is model._get_index()[1]
+    extra = Linear(2, 2)
+    extra.initialize()
+    model.layers.append(extra)
+    assert extra in list(model.walk())
+    extra.inc_grad("W", extra.ops.alloc2f(2, 2) + 1)
+    assert (extra.id, "W") in model.get_gradients()
+    model.remove_node(child)
+    assert child not in list(model.walk())
+    assert child.id not in {node.id for node, _ in model._get_index()[1]}
+    model.layers[0].set_param("Q", model.ops.alloc1f(2))
+    assert (model.layers[0], "Q") in model._get_index()[1]
+    model._layers = []
+    assert list(model.walk()) == [model]
+
+
+def test_finish_update_reuses_gradient_buffers():
+    model = chain(Relu(4, 3), Softmax(2, 4))
+    model.initialize()
+    X = numpy.random.uniform(-1, 1, (6, 3)).astype("f")
+    dY = numpy.random.uniform(-1, 1, (6, 2)).astype("f")
+    Yh, backprop = model.begin_update(X)
+    backprop(dY)
+    full = {key: grad.copy() for key, (_, grad) in model.get_gradients().items()}
+    buffers = {key: grad for key, (_, grad) in model.get_gradients().items()}
+    model.finish_update(SGD(0.0))
+    for key, (_, grad) in model.get_gradients().items():
+        assert grad is buffers[key]
+        assert not grad.any()
+    for start in range(0, 6, 2):
+        Yh, backprop = model.begin_update(X[start : start + 2])
+        backprop(dY[start : start + 2])
+    for key, (_, grad) in model.get_gradients().items():
+        assert grad is buffers[key]
+        numpy.testing.assert_allclose(grad, full[key], rtol=1e-5, atol=1e-6)
+    model.finish_update(SGD(0.0), n_accumulated=3)
+    for key, (_, grad) in model.get_gradients().items():
+        assert grad is buffers[key]
+    with pytest.raises(ValueError):
+        model.finish_update(SGD(0.0), n_accumulated=0)
+
+
 def test_model_can_save_to_disk(model_with_no_args):
     with make_tempdir() as path:
         model_with_no_args.to_disk(path / "thinc_model")
@@ -182,6 +235,55 @@ def test_set_dropout_2(model_with_no_args):
     assert model.attrs["dropout_rate"] == 0.2
 
 
+def test_no_grad_predict_matches_forward():
+    model = chain(
+        concatenate(Maxout(4, 5, normalize=True), Relu(4, 5)),
+        residual(Relu(8, 8)),
+        Softmax(3, 8),
+    )
+    model.initialize()
+    X = numpy.random.uniform(-1, 1, (6, 5)).astype("f")
+    Y, _ = model(X, is_train=False)
+    numpy.testing.assert_allclose(model.predict(X), Y, rtol=1e-5)
+    with no_grad():
+        Yh, backprop = model(X, is_train=False)
+    numpy.testing.assert_allclose(Yh, Y, rtol=1e-5)
+    with pytest.raises(ValueError):
+        backprop(Yh)
+    # Outside the context, backprop callbacks are built as usual.
+    Yh, backprop = model.begin_update(X)
+    backprop(Yh)
+
+
+def test_no_grad_predict_matches_forward_with_dropout():
+    model = chain(
+        HashEmbed(8, 100, dropout=0.2),
+        Relu(8, 8, dropout=0.5),
+        Dropout(0.3),
+        Softmax(3, 8),
+    )
+    model.initialize()
+    ids = numpy.arange(6, dtype="uint64")
+    numpy.random.seed(0)
+    Y, _ = model(ids, is_train=False)
+    numpy.random.seed(0)
+    numpy.testing.assert_allclose(model.predict(ids), Y, rtol=1e-5)
+
+
+def test_param_index_dropped_on_pickle_and_deepcopy():
+    model = chain(Linear(2, 2), Linear(2, 2))
+    model.initialize()
+    model._get_index()
+    assert model._index is not None
+    pickled = srsly.pickle_loads(srsly.pickle_dumps(model))
+    for copied in (copy.deepcopy(model), pickled):
+        assert copied._index is None
+        nodes = list(copied.walk())
+        assert [node.id for node in nodes] == [node.id for node in model.walk()]
+        assert nodes[1] is copied.layers[0]
+        assert len(copied._get_index()[1]) == 4
+
+
 def test_bind_plus():
     with Model.define_operators({"+": lambda a, b: (a.name, b.name)}):
         m = create_model(name="a") + create_model(name="b")
@@ -396,3 +498,80 @@ def test_model_gpu():
             Yh = model.predict(X)
             correct += (Yh.argmax(axis=1) == Y.argmax(axis=1)).sum()
             total += Yh.shape[0]
+
+
+def test_copy_share_params():
+    model = chain(Relu(4, 3, dropout=0.2), Linear(2, 4))
+    model.initialize()
+    replica = model.copy(share_params=True)
+    X = numpy.random.uniform(-1, 1, (5, 3)).astype("f")
+    # Dropout is applied in predict too, so draw the same masks.
+    numpy.random.seed(0)
+    Y = replica.predict(X)
+    numpy.random.seed(0)
+    numpy.testing.assert_allclose(Y, model.predict(X))
+    W = model.layers[0].layers[0].get_param("W")
+    W_replica = replica.layers[0].layers[0].get_param("W")
+    assert numpy.shares_memory(W, W_replica)
+    with pytest.raises(ValueError):
+        W_replica[0, 0] = 1.0
+    # Attrs are separate, so the replica can change its dropout rate alone.
+    set_dropout_rate(replica, 0.5)
+    assert model.layers[0].layers[-1].attrs["dropout_rate"] == 0.2
+    # Training the replica copies the parameters it writes, and leaves the
+    # original untouched.
+    original = W.copy()
+    Y, backprop = replica.begin_update(X)
+    backprop(numpy.ones_like(Y))
+    replica.finish_update(SGD(0.1))
+    W_replica = replica.layers[0].layers[0].get_param("W")
+    assert not numpy.shares_memory(W, W_replica)
+    numpy.testing.assert_equal(W, original)
+    assert not numpy.allclose(W_replica, original)
+
+
+def test_copy_share_params_train_original():
+    model = chain(Relu(4, 3), Linear(2, 4))
+    model.initialize()
+    replica = model.copy(share_params=True)
+    X = numpy.random.uniform(-1, 1, (5, 3)).astype("f")
+    expected = replica.predict(X)
+    # The optimizer updates the weights in place, so the original has to copy
+    # the buffers it shares before it's updated.
+    optimizer = Adam(0.1)
+    for i in range(3):
+        Y, backprop = model.begin_update(X)
+        backprop(numpy.ones_like(Y))
+        model.finish_update(optimizer)
+    numpy.testing.assert_equal(replica.predict(X), expected)
+    assert not numpy.allclose(model.predict(X), expected)
+
+
+def test_get_packed_param():
+    model = Linear(3, 2).initialize()
+    calls = []
+
+    def pack(W):
+        calls.append(W)
+        return W.T.copy()
+
+    packed = model.get_packed_param("W", pack)
+    assert model.get_packed_param("W", pack) is packed
+    assert len(calls) == 1
+    numpy.testing.assert_equal(packed, model.get_param("W").T)
+    Y, backprop = model.begin_update(numpy.ones((4, 2), dtype="f"))
+    backprop(Y)
+    model.finish_update(SGD(0.1))
+    packed = model.get_packed_param("W", pack)
+    assert len(calls) == 2
+    numpy.testing.assert_equal(packed, model.get_param("W").T)
+
+
+def test_to_cpu_param_dtypes():
+    model = Linear(3, 2).initialize()
+    model.set_param("W", model.get_param("W").astype("float64"))
+    model.set_param("W_indices", numpy.arange(3, dtype="int32"))
+    model.to_cpu()
+    # Floats are cast to float32, and integer parameters keep their dtype.
+    assert model.get_param("W").dtype == "float32"
+    assert model.get_param("W_indices").dtype == "int32"
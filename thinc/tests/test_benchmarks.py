@@ -0,0 +1,89 @@
+import srsly
+from thinc.benchmarks import run_ops_benchmarks, run_training_benchmarks
+from thinc.benchmarks import compare_results, format_comparison
+from thinc.benchmarks.__main__ import main
+from thinc.benchmarks.training import format_phases
+
+from .util import make_tempdir
+
+
+def test_run_ops_benchmarks():
+    results = run_ops_benchmarks(
+        backends=["numpy"], pattern="^mish$", repeat=2, min_time=0.0
+    )
+    assert results["meta"]["thinc"]
+    assert len(results["results"]) == 2
+    for result in results["results"]:
+        assert result["backend"] == "numpy"
+        assert result["name"] == "mish"
+        assert "error" not in result
+        assert 0 < result["min"] <= result["median"]
+    srsly.json_dumps(results)
+
+
+def test_compare_results_flags_regressions():
+    baseline = run_ops_benchmarks(
+        backends=["numpy"], pattern="^relu$", repeat=1, min_time=0.0
+    )
+    results = srsly.json_loads(srsly.json_dumps(baseline))
+    results["results"][0]["median"] *= 2
+    results["results"][1]["median"] *= 1.05
+    comparison = compare_results(results, baseline, threshold=0.1)
+    assert [c["regression"] for c in comparison] == [True, False]
+    with make_tempdir() as tmp_dir:
+        srsly.write_json(tmp_dir / "results.json", results)
+        srsly.write_json(tmp_dir / "baseline.json", baseline)
+        args = [str(tmp_dir / "results.json"), str(tmp_dir / "baseline.json")]
+        assert main(["compare"] + args) == 1
+        assert main(["compare"] + args + ["--threshold", "1.5"]) == 0
+        output = str(tmp_dir / "ops.json")
+        assert main(["--filter", "^relu$", "--repeat", "1", "--output", output]) == 0
+        assert len(srsly.read_json(output)["results"]) == 2
+
+
+def test_compare_results_flags_errors_and_missing():
+    baseline = run_ops_benchmarks(
+        backends=["numpy"], pattern="^relu$", repeat=1, min_time=0.0
+    )
+    results = srsly.json_loads(srsly.json_dumps(baseline))
+    del results["results"][0]["median"]
+    results["results"][0]["error"] = "ValueError: boom"
+    missing = results["results"].pop(1)
+    comparison = compare_results(results, baseline, threshold=0.1)
+    assert [c["status"] for c in comparison] == ["error", "missing"]
+    assert all(c["regression"] for c in comparison)
+    assert comparison[1]["label"] == missing["label"]
+    assert "ERROR" in format_comparison(comparison)
+    # Benchmarks that only exist in the new results aren't compared.
+    assert compare_results(baseline, results) == []
+
+
+def test_run_training_benchmarks():
+    names = [
+        "cnn_tagger",
+        "cnn_windowed_tagger",
+        "lstm_tagger",
+        "sparse_textcat",
+        "attention_textcat",
+    ]
+    results = run_training_benchmarks(names=names, n_steps=2, batch_size=4)
+    assert [(r["name"], r["label"]) for r in results["results"]] == [
+        (name, label) for name in names for label in ("train", "predict")
+    ]
+    for result in results["results"]:
+        assert result["words_per_second"] > 0
+        assert result["n_words"] > 0
+        assert abs(sum(result["phases"].values()) - result["seconds"]) < 1e-6
+        # Each benchmark runs in its own process, so the peak RSS is its own.
+        assert result["peak_rss_scope"] == "benchmark"
+    train = results["results"][0]
+    assert set(train["phases"]) == {"batching", "forward", "backward", "optimizer"}
+    assert "(process)" not in format_phases(results)
+    process_wide = srsly.json_loads(srsly.json_dumps(results))
+    process_wide["results"][0]["peak_rss_scope"] = "process"
+    assert "(process)" in format_phases(process_wide)
+    # Throughput is higher-is-better, so a drop is a regression.
+    slower = srsly.json_loads(srsly.json_dumps(results))
+    slower["results"][0]["words_per_second"] /= 2
+    comparison = compare_results(slower, results, threshold=0.1)
+    assert [c["regression"] for c in comparison][:2] == [True, False]
@@ -1,7 +1,8 @@
 import pytest
 import numpy
 from thinc.api import CategoricalCrossentropy, SequenceCategoricalCrossentropy
-from thinc.api import L2Distance, CosineDistance
+from thinc.api import L2Distance, CosineDistance, Ragged, Ops
+from thinc.api import get_current_ops, set_current_ops
 from thinc import registry
 
 # some simple arrays
@@ -100,6 +101,65 @@ def test_sequence_categorical_crossentropy(guesses, labels):
     assert losses[1] == pytest.approx(0.529999, eps)
 
 
+def test_categorical_crossentropy_from_logits():
+    logits = numpy.asarray([[2.0, 1.0, 0.1], [0.5, 0.5, 3.0]], dtype="f")
+    labels = numpy.asarray([0, 1], dtype="i")
+    probs = numpy.exp(logits) / numpy.exp(logits).sum(axis=1, keepdims=True)
+    expected_grad = (probs - labels1_full[[2, 1]]) / 2
+    expected_loss = -numpy.log(probs[[0, 1], labels]).sum() / 2
+    loss_func = CategoricalCrossentropy(from_logits=True)
+    for truths in (labels, labels1_full[[2, 1]].astype("f")):
+        d_logits, loss = loss_func(logits, truths)
+        assert d_logits.shape == logits.shape
+        assert d_logits == pytest.approx(expected_grad, eps)
+        assert loss == pytest.approx(expected_loss, eps)
+
+
+def test_categorical_crossentropy_uses_current_ops():
+    class RecordingOps(Ops):
+        calls = 0
+
+        def softmax_cross_entropy(self, logits, truths):
+            RecordingOps.calls += 1
+            return super().softmax_cross_entropy(logits, truths)
+
+    logits = numpy.asarray([[2.0, 1.0, 0.1], [0.5, 0.5, 3.0]], dtype="f")
+    labels = numpy.asarray([0, 1], dtype="i")
+    loss_func = CategoricalCrossentropy(from_logits=True)
+    expected = loss_func(logits, labels)
+    ops = get_current_ops()
+    set_current_ops(RecordingOps())
+    try:
+        d_logits, loss = loss_func(logits, labels)
+    finally:
+        set_current_ops(ops)
+    assert RecordingOps.calls == 1
+    assert d_logits == pytest.approx(expected[0], eps)
+    assert loss == pytest.approx(expected[1], eps)
+
+
+@pytest.mark.parametrize("from_logits", [False, True])
+def test_sequence_categorical_crossentropy_ragged(from_logits):
+    guesses = [
+        numpy.asarray([[0.1, 0.5, 0.6], [0.4, 0.6, 0.3]], dtype="f"),
+        numpy.zeros((0, 3), dtype="f"),
+        numpy.asarray([[1, 1, 1], [0, 0, 0], [0.2, 0.3, 0.5]], dtype="f"),
+    ]
+    labels = [numpy.asarray(y, dtype="i") for y in ([2, 1], [], [0, 2, 1])]
+    loss_func = SequenceCategoricalCrossentropy(from_logits=from_logits)
+    expected_grads, expected_losses = loss_func(guesses, labels)
+    lengths = numpy.asarray([len(yh) for yh in guesses], dtype="i")
+    ragged = Ragged(numpy.concatenate(guesses), lengths)
+    d_ragged, losses = loss_func(ragged, numpy.concatenate(labels))
+    assert isinstance(d_ragged, Ragged)
+    assert d_ragged.data == pytest.approx(numpy.concatenate(expected_grads), eps)
+    assert losses == pytest.approx(expected_losses, eps)
+    for yh, y, d_yh, loss in zip(guesses, labels, expected_grads, expected_losses):
+        cc = CategoricalCrossentropy(from_logits=from_logits)
+        assert d_yh == pytest.approx(cc.get_grad(yh, y), eps)
+        assert loss == pytest.approx(cc.get_loss(yh, y), eps)
+
+
 def test_L2():
     # L2 loss = 2²+4²=20 (or normalized: 1²+2²=5)
     vec1 = numpy.asarray([[1, 2], [8, 9]])
@@ -97,3 +97,14 @@ def test_optimizer_init():
     optimizer((0, "x"), W, dW)
     optimizer = Optimizer(learn_rate=0.123, beta1=0.1, beta2=0.1)
     optimizer((1, "x"), W, dW)
+
+
+@pytest.mark.parametrize("name", ["Adam.v1", "RAdam.v1", "SGD.v1"])
+def test_optimizer_zeros_gradient_in_place(name):
+    config = {"test": {"@optimizers": name, "learn_rate": 0.1}}
+    optimizer = registry.make_from_config(config)["test"]
+    weights = numpy.ones((6,), dtype="f")
+    gradient = numpy.ones((6,), dtype="f")
+    _, new_gradient = optimizer((0, "x"), weights, gradient)
+    assert new_gradient is gradient
+    assert not gradient.any()
@@ -0,0 +1,113 @@
+import pytest
+import multiprocessing
+import numpy
+from numpy.testing import assert_allclose
+from thinc.api import chain, Relu, Softmax, Adam, CategoricalCrossentropy
+from thinc.api import Dropout, WindowedMaxout, no_grad
+from thinc.model import NO_GRAD
+from thinc.parallel import DataParallel, run_parallel
+
+
+def _make_model():
+    model = chain(Relu(6, 4), Softmax(3, 6))
+    model.initialize()
+    return model
+
+
+def _get_params(model):
+    return {
+        (i, name): node.get_param(name).copy()
+        for i, node in enumerate(model.walk())
+        for name in node.param_names
+    }
+
+
+@pytest.mark.parametrize("n_workers", [1, 2, 3])
+def test_data_parallel_matches_serial_update(n_workers):
+    X = numpy.random.uniform(-1, 1, (10, 4)).astype("f")
+    Y = numpy.random.randint(0, 3, (10,))
+    serial = _make_model()
+    model = _make_model()
+    model.from_bytes(serial.to_bytes())
+    loss_func = CategoricalCrossentropy()
+    serial_optimizer = Adam(0.01)
+    for _ in range(3):
+        Yh, backprop = serial.begin_update(X)
+        backprop(loss_func.get_grad(Yh, Y))
+        serial.finish_update(serial_optimizer)
+    with DataParallel(model, Adam(0.01), loss_func, n_workers) as trainer:
+        for _ in range(3):
+            trainer.update(X, Y)
+    expected = _get_params(serial)
+    for key, value in _get_params(model).items():
+        assert_allclose(value, expected[key], rtol=1e-4, atol=1e-6)
+    # After closing, the parameters are no longer views into the arena.
+    W = model.layers[0].get_param("W")
+    assert W.base is None
+
+
+def test_data_parallel_repacks_updated_weights():
+    # WindowedMaxout caches its packed weights, and the workers have to repack
+    # them after each update to the shared parameters. A single worker is
+    # used, as the windows would otherwise differ at the shard boundaries.
+    X = numpy.random.uniform(-1, 1, (10, 4)).astype("f")
+    Y = numpy.random.randint(0, 3, (10,))
+    serial = chain(WindowedMaxout(6, 4, window_size=1), Softmax(3, 6))
+    serial.initialize(X=X)
+    model = serial.copy()
+    loss_func = CategoricalCrossentropy()
+    serial_optimizer = Adam(0.1)
+    for _ in range(3):
+        Yh, backprop = serial.begin_update(X)
+        backprop(loss_func.get_grad(Yh, Y))
+        serial.finish_update(serial_optimizer)
+    with DataParallel(model, Adam(0.1), loss_func, 1) as trainer:
+        for _ in range(3):
+            trainer.update(X, Y)
+    expected = _get_params(serial)
+    for key, value in _get_params(model).items():
+        assert_allclose(value, expected[key], rtol=1e-4, atol=1e-6)
+
+
+def test_data_parallel_workers_draw_different_masks():
+    queue = multiprocessing.get_context("fork").SimpleQueue()
+
+    def get_loss(Yh, Y):
+        queue.put(Yh != 0)
+        return Yh * 0, 0.0
+
+    X = numpy.ones((2, 64), dtype="f")
+    with DataParallel(Dropout(0.5), Adam(0.01), get_loss, 2) as trainer:
+        trainer.update(X, X)
+        masks = [queue.get(), queue.get()]
+    assert masks[0].any() and masks[1].any()
+    assert (masks[0] != masks[1]).any()
+
+
+def test_data_parallel_reports_worker_errors():
+    model = _make_model()
+    X = numpy.zeros((4, 5), dtype="f")
+    Y = numpy.zeros((4,), dtype="i")
+    trainer = DataParallel(model, Adam(0.01), CategoricalCrossentropy(), 2)
+    with pytest.raises(RuntimeError):
+        trainer.update(X, Y)
+    with pytest.raises(ValueError):
+        trainer.update(X, Y)
+
+
+def test_run_parallel_keeps_order_and_context():
+    def nested(i):
+        return sum(run_parallel([lambda: i, lambda: NO_GRAD.get()]))
+
+    funcs = [lambda i=i: nested(i) for i in range(6)]
+    assert run_parallel(funcs) == list(range(6))
+    with no_grad():
+        assert run_parallel(funcs) == list(range(1, 7))
+
+
+def test_run_parallel_raises_errors():
+    def fail():
+        raise KeyError("branch")
+
+    with pytest.raises(KeyError):
+        run_parallel([lambda: 1, fail])
@@ -0,0 +1,149 @@
+import pytest
+import numpy
+from numpy.testing import assert_allclose
+from thinc.api import Linear, Softmax, MultiSoftmax
+from thinc.api import NumpyOps, Ops, Config, registry, Precision
+from thinc.api import use_precision, get_current_precision, set_current_precision
+from .util import make_dense_model
+
+
+@pytest.mark.parametrize("ops", [NumpyOps(), Ops()])
+@pytest.mark.parametrize("storage", ["float32", "float16", "bfloat16"])
+def test_compress_floats(ops, storage):
+    X = numpy.random.uniform(-10, 10, (7, 33)).astype("f")
+    X_c = ops.compress_floats(X, storage)
+    assert X_c.dtype == {"bfloat16": "uint16"}.get(storage, storage)
+    assert X_c.shape == X.shape
+    X_d = ops.decompress_floats(X_c, storage)
+    assert X_d.dtype == "float32"
+    rtol = {"float32": 0.0, "float16": 2 ** -11, "bfloat16": 2 ** -8}[storage]
+    assert_allclose(X_d, X, rtol=rtol, atol=1e-30)
+    # The native conversions round the same way as the fallback.
+    assert (X_c == Ops().compress_floats(X, storage)).all()
+
+
+def test_compress_floats_bfloat16():
+    ops = NumpyOps()
+    X = numpy.asarray([1.0, -2.5, 0.0, numpy.inf, numpy.nan], dtype="f")
+    X_d = ops.decompress_floats(ops.compress_floats(X, "bfloat16"), "bfloat16")
+    assert_allclose(X_d[:4], X[:4])
+    assert numpy.isnan(X_d[4])
+    # 1 + 2**-8 is halfway between two bfloat16 values, so it rounds to even.
+    X = numpy.asarray([1 + 2 ** -8, 1 + 3 * 2 ** -8], dtype="f")
+    X_d = ops.decompress_floats(ops.compress_floats(X, "bfloat16"), "bfloat16")
+    assert_allclose(X_d, [1.0, 1 + 2 ** -6])
+    with pytest.raises(ValueError):
+        ops.compress_floats(X, "float8")
+
+
+@pytest.mark.parametrize("ops", [NumpyOps(), Ops()])
+@pytest.mark.parametrize("storage", ["float16", "bfloat16"])
+@pytest.mark.parametrize("shape", [(1, 3, 5), (7, 20, 33), (9, 8, 40), (40, 6, 17)])
+def test_gemm_compressed(ops, storage, shape):
+    N, nO, nI = shape
+    X = numpy.random.uniform(-1, 1, (N, nI)).astype("f")
+    W = numpy.random.uniform(-1, 1, (nO, nI)).astype("f")
+    W_c = ops.compress_floats(W, storage)
+    Y = ops.gemm_compressed(X, W_c, storage)
+    assert_allclose(Y, X @ ops.decompress_floats(W_c, storage).T, atol=1e-5)
+    with pytest.raises(ValueError):
+        ops.gemm_compressed(X[:, 1:], W_c, storage)
+    with pytest.raises(ValueError):
+        ops.gemm_compressed(X, W, storage)
+
+
+def test_precision_config():
+    config_str = """
+    [precision]
+    @precisions = "mixed_precision.v1"
+    params = "float16"
+    activations = "bfloat16"
+    """
+    precision = registry.make_from_config(Config().from_str(config_str))["precision"]
+    assert precision.params == "float16"
+    assert precision.activations == "bfloat16"
+    with pytest.raises(ValueError):
+        Precision(params="int8")
+    assert get_current_precision().params == "float32"
+    with use_precision(precision):
+        assert get_current_precision() is precision
+    assert get_current_precision().params == "float32"
+    set_current_precision(precision)
+    assert get_current_precision() is precision
+    set_current_precision(Precision())
+
+
+@pytest.mark.parametrize("storage", ["float16", "bfloat16"])
+def test_precision_params(storage):
+    model, X = make_dense_model(Linear(16, 16), Softmax(5, 16))
+    expected = model.predict(X)
+    W = model.layers[0].get_param("W")
+    with use_precision(Precision(params=storage)):
+        Y = model.predict(X)
+        assert_allclose(Y, expected, atol=0.02)
+        # The reduced copy is only used at inference.
+        Y, _ = model.begin_update(X)
+        assert_allclose(Y, expected, atol=1e-5)
+        # Setting the weights drops the reduced copy.
+        model.layers[0].set_param("W", W * 2)
+        Y = model.predict(X)
+    assert_allclose(Y, model.predict(X), atol=0.02)
+
+
+def test_precision_multisoftmax():
+    model = MultiSoftmax((2, 3), 4)
+    model.initialize()
+    W = numpy.random.uniform(-1, 1, model.get_param("W").shape).astype("f")
+    model.set_param("W", W)
+    X = numpy.random.uniform(-1, 1, (6, 4)).astype("f")
+    expected = model.predict(X)
+    with use_precision(Precision(params="bfloat16")):
+        Y = model.predict(X)
+    assert_allclose(Y, expected, atol=0.02)
+    assert_allclose(Y[:, :2].sum(axis=1), 1.0, rtol=1e-5)
+
+
+@pytest.mark.parametrize("storage", ["float16", "bfloat16"])
+def test_precision_activations(storage):
+    reference, X = make_dense_model(Linear(16, 16), Softmax(5, 16))
+    model = reference.copy()
+    Y, backprop = reference.begin_update(X)
+    dX = backprop(Y)
+    with use_precision(Precision(activations=storage)):
+        Y2, backprop = model.begin_update(X)
+        assert_allclose(Y2, Y)
+        # Only the gradients of the weights depend on the saved inputs.
+        assert_allclose(backprop(Y2), dX, atol=1e-6)
+    for node, ref_node in zip(model.walk(), reference.walk()):
+        if ref_node.has_grad("W"):
+            assert_allclose(node.get_grad("W"), ref_node.get_grad("W"), atol=0.02)
+
+
+def test_with_precision_from_config():
+    config_str = """
+    [model]
+    @layers = "with_precision.v1"
+
+    [model.precision]
+    @precisions = "mixed_precision.v1"
+    params = "bfloat16"
+    activations = "bfloat16"
+
+    [model.layer]
+    @layers = "Linear.v1"
+    nO = 4
+    nI = 3
+    """
+    model = registry.make_from_config(Config().from_str(config_str))["model"]
+    model.initialize()
+    linear = model.layers[0]
+    X = numpy.random.uniform(-1, 1, (5, 3)).astype("f")
+    Y = model.predict(X)
+    assert_allclose(Y, linear.predict(X), atol=0.02)
+    # The reduced copy of the weights was made under the model's policy.
+    copies = linear.get_packed_param("W", dict)
+    assert "bfloat16" in copies
+    assert get_current_precision().params == "float32"
+    Y, backprop = model.begin_update(X)
+    assert backprop(Y).shape == X.shape
+    assert linear.has_grad("W")
@@ -0,0 +1,60 @@
+import pytest
+import numpy
+from thinc.api import chain, Linear, Relu, Softmax, profile_model
+from thinc.api import quantize_int8, track_memory
+
+
+def test_profile_model():
+    model = chain(Relu(8, 4), Relu(8, 8), Softmax(3, 8))
+    model.initialize()
+    X = numpy.random.uniform(-1, 1, (5, 4)).astype("f")
+    forward = model._func
+    with profile_model(model) as profiler:
+        for _ in range(2):
+            Y, backprop = model.begin_update(X)
+            backprop(Y)
+        model.predict(X)
+    assert model._func is forward
+    assert "alloc" not in model.ops.__dict__
+    stats = profiler.get_stats()
+    assert stats["relu"]["n_forward"] == 6
+    assert stats["relu"]["n_backward"] == 4
+    assert stats["softmax"]["n_forward"] == 3
+    # Forward: X (5, 4) @ W.T (4, 8); backward: dX and dW for the first layer.
+    assert stats["relu"]["flops"] > 0
+    assert stats["softmax"]["flops"] == 3 * 2 * 5 * 8 * 3 + 2 * 2 * (2 * 5 * 8 * 3)
+    assert stats["softmax"]["shapes"] == ["5x8 -> 5x3"]
+    assert stats["relu>>relu>>softmax"]["flops"] == 0
+    chain_stats = stats["relu>>relu>>softmax"]
+    assert chain_stats["time_forward"] >= stats["softmax"]["time_forward"]
+    assert "relu" in profiler.format_table()
+    trace = profiler.to_chrome_trace()
+    events = trace["traceEvents"]
+    assert len(events) == 3 * 4 + 2 * 4
+    assert {event["cat"] for event in events} == {"forward", "backward"}
+    assert all(event["ph"] == "X" and event["dur"] >= 0 for event in events)
+
+
+def test_profile_model_counts_gemm_variants():
+    model = chain(Linear(3, 4), Linear(2, 3))
+    model.initialize()
+    quantize_int8(model)
+    X = numpy.random.uniform(-1, 1, (5, 4)).astype("f")
+    with profile_model(model) as profiler:
+        with pytest.raises(ValueError):
+            with track_memory():
+                pass
+        model.predict(X)
+        n_bytes = profiler.step()["allocated_bytes"]
+    stats = profiler.get_stats()
+    assert stats["linear"]["flops"] == 2 * 5 * 4 * 3 + 2 * 5 * 3 * 2
+    assert stats["linear"]["alloc_bytes"] > 0
+    assert n_bytes >= stats["linear"]["alloc_bytes"]
+    ops = model.ops
+    W = numpy.random.uniform(-1, 1, (3, 4 * 3)).astype("f")
+    with profile_model(model) as profiler:
+        with profiler.node("window") as frame:
+            frame["flops"] = 0
+            ops.window_gemm(X, W, 1)
+    # The gemm calls inside window_gemm aren't counted twice.
+    assert frame["flops"] == 2 * 5 * 4 * 3 * 3
@@ -0,0 +1,127 @@
+import pytest
+import numpy
+from numpy.testing import assert_allclose
+from thinc.api import Linear, Adam, compounding
+from thinc.api import NumpyOps, Ops, MagnitudePruner, sparsify
+from .util import make_dense_model
+
+
+def _to_csr(W):
+    rows, cols = numpy.nonzero(W)
+    indptr = numpy.zeros((W.shape[0] + 1,), dtype="i")
+    indptr[1:] = numpy.cumsum((W != 0).sum(axis=1))
+    return W[rows, cols].astype("f"), cols.astype("i"), indptr
+
+
+@pytest.mark.parametrize("ops", [NumpyOps(), Ops()])
+@pytest.mark.parametrize("shape", [(1, 3, 5), (7, 20, 33), (9, 8, 40), (0, 4, 4)])
+def test_sparse_gemm(ops, shape):
+    _check_sparse_gemm(ops, shape)
+
+
+def test_sparse_gemm_blocks(monkeypatch):
+    # The generic implementation processes X in blocks of rows.
+    monkeypatch.setattr("thinc.backends.ops._CSR_BLOCK_SIZE", 50)
+    _check_sparse_gemm(Ops(), (9, 8, 40))
+
+
+def _check_sparse_gemm(ops, shape):
+    N, nO, nI = shape
+    X = numpy.random.uniform(-1, 1, (N, nI)).astype("f")
+    W = numpy.random.uniform(-1, 1, (nO, nI)).astype("f")
+    W[numpy.abs(W) < 0.7] = 0
+    W[0] = 0
+    W[-1, -1] = 1.0
+    data, indices, indptr = _to_csr(W)
+    Y = ops.sparse_gemm(X, data, indices, indptr)
+    assert_allclose(Y, X @ W.T, atol=1e-5)
+    dY = numpy.random.uniform(-1, 1, (N, nO)).astype("f")
+    dX, d_data = ops.backprop_sparse_gemm(dY, X, data, indices, indptr)
+    assert_allclose(dX, dY @ W, atol=1e-5)
+    dW = dY.T @ X
+    assert_allclose(d_data, dW[numpy.nonzero(W)], atol=1e-5)
+    with pytest.raises(ValueError):
+        ops.sparse_gemm(X, data, indices, indptr[:-1])
+    with pytest.raises(ValueError):
+        ops.sparse_gemm(X[:, :-1].copy(), data, indices, indptr)
+
+
+def test_magnitude_pruner():
+    model, X = make_dense_model(Linear(5, 16))
+    pruner = MagnitudePruner([0.5, 0.8])
+    assert pruner(model) == 0.5
+    for node in (model.layers[0], model.layers[2]):
+        W = node.get_param("W")
+        assert (W == 0).sum() == int(round(0.5 * W.size))
+    assert pruner(model) == 0.8
+    # The schedule is exhausted, so its last value is kept.
+    assert pruner(model) == 0.8
+    W = model.layers[0].get_param("W")
+    assert (W == 0).sum() == int(round(0.8 * W.size))
+    # Layers that aren't selected are left alone.
+    assert (model.layers[1].get_param("W") != 0).all()
+    with pytest.raises(ValueError):
+        MagnitudePruner(1.5)
+
+
+def test_magnitude_pruner_training():
+    model, X = make_dense_model(Linear(5, 16))
+    Y = numpy.random.uniform(-1, 1, (20, 5)).astype("f")
+    optimizer = Adam(0.001)
+    pruner = MagnitudePruner(compounding(0.1, 0.9, 1.5))
+    for i in range(10):
+        Yh, backprop = model.begin_update(X)
+        backprop(Yh - Y)
+        model.finish_update(optimizer)
+        pruner(model)
+    W = model.layers[0].get_param("W")
+    assert (W == 0).sum() == int(round(0.9 * W.size))
+
+
+def test_sparsify():
+    model, X = make_dense_model(Linear(5, 16))
+    MagnitudePruner(0.8)(model)
+    expected = model.predict(X)
+    nodes = (model.layers[0], model.layers[2])
+    n_weights = [int((node.get_param("W") != 0).sum()) for node in nodes]
+    sparsify(model)
+    for node, n in zip(nodes, n_weights):
+        assert node.has_param("W") is None
+        assert not node._params.has_param(node.id, "W")
+        assert node.get_param("W_data").size == n
+        assert node.get_param("W_indptr").dtype == "int32"
+    assert_allclose(model.predict(X), expected, atol=1e-5)
+
+
+def test_sparsify_gradients():
+    model, X = make_dense_model(Linear(5, 16))
+    MagnitudePruner(0.8)(model)
+    dense = model.copy()
+    sparsify(model)
+    Y, backprop = model.begin_update(X)
+    dense_Y, dense_backprop = dense.begin_update(X)
+    assert_allclose(Y, dense_Y, atol=1e-5)
+    dY = numpy.random.uniform(-1, 1, Y.shape).astype("f")
+    assert_allclose(backprop(dY), dense_backprop(dY), atol=1e-5)
+    for node, dense_node in zip(model.layers, dense.layers):
+        assert_allclose(node.get_grad("b"), dense_node.get_grad("b"), atol=1e-5)
+        if node.has_param("W_data"):
+            W = dense_node.get_param("W")
+            W = W.reshape((-1, W.shape[-1]))
+            dW = dense_node.get_grad("W").reshape(W.shape)
+            assert_allclose(node.get_grad("W_data"), dW[numpy.nonzero(W)], atol=1e-5)
+    # Training updates the non-zero values only.
+    n_weights = model.layers[0].get_param("W_data").size
+    model.finish_update(Adam(0.001))
+    assert model.layers[0].get_param("W_data").size == n_weights
+
+
+def test_sparsify_serialization():
+    model, X = make_dense_model(Linear(5, 16))
+    MagnitudePruner(0.9)(model)
+    sparsify(model)
+    model_bytes = model.to_bytes()
+    loaded, _ = make_dense_model(Linear(5, 16))
+    loaded.from_bytes(model_bytes)
+    assert loaded.layers[0].get_param("W_indices").dtype == "int32"
+    assert_allclose(loaded.predict(X), model.predict(X))
@@ -0,0 +1,81 @@
+import pytest
+import numpy
+from numpy.testing import assert_allclose
+from thinc.api import Linear, Softmax, MultiSoftmax
+from thinc.api import NumpyOps, Ops, quantize_int8, compare_predictions
+from .util import make_dense_model
+
+
+@pytest.mark.parametrize("ops", [NumpyOps(), Ops()])
+@pytest.mark.parametrize("shape", [(1, 3, 5), (7, 20, 33), (9, 8, 40)])
+def test_gemm_int8(ops, shape):
+    N, nO, nI = shape
+    X = numpy.random.uniform(-1, 1, (N, nI)).astype("f")
+    W = numpy.random.uniform(-1, 1, (nO, nI)).astype("f")
+    W_int8, W_scale = ops.quantize_int8(W)
+    assert W_int8.dtype == "int8"
+    assert_allclose(W_int8 * W_scale[:, None], W, atol=0.5 / 127)
+    Y = ops.gemm_int8(X, W_int8, W_scale)
+    assert_allclose(Y, X @ W.T, atol=0.05)
+    # The native kernel computes the same integer products as the fallback.
+    assert_allclose(Y, Ops().gemm_int8(X, W_int8, W_scale), rtol=1e-6)
+    # With a fixed input scale, larger values are clipped.
+    Y_clipped = ops.gemm_int8(X * 2, W_int8, W_scale, X_scale=1.0 / 127)
+    expected = ops.gemm_int8((X * 2).clip(-1, 1), W_int8, W_scale, X_scale=1.0 / 127)
+    assert_allclose(Y_clipped, expected)
+    with pytest.raises(ValueError):
+        ops.gemm_int8(X[:, 1:], W_int8, W_scale)
+    with pytest.raises(ValueError):
+        ops.gemm_int8(X, W_int8, W_scale, X_scale=0.0)
+
+
+def test_quantize_int8():
+    model, X = make_dense_model(Linear(16, 16), Softmax(5, 16))
+    reference = model.copy()
+    quantize_int8(model)
+    for node in model.walk():
+        if node.name in ("maxout", "linear", "softmax"):
+            assert node.get_param("W_int8").dtype == "int8"
+            assert node.has_param("W") is None
+            assert not node._params.has_param(node.id, "W")
+            assert not node._params.has_grad(node.id, "W")
+    assert_allclose(model.predict(X), reference.predict(X), atol=0.02)
+    Y, backprop = model.begin_update(X)
+    with pytest.raises(ValueError):
+        backprop(Y)
+    results = compare_predictions(reference, model, [X, X[:3]])
+    assert results["max_abs_diff"] < 0.02
+    assert results["argmax_agreement"] > 0.9
+
+
+def test_quantize_int8_calibration():
+    model, X = make_dense_model(Linear(16, 16), Softmax(5, 16))
+    reference = model.copy()
+    quantize_int8(model, calibration_data=[X[:10], X[10:]])
+    for node in model.walk():
+        if node.name in ("maxout", "linear", "softmax"):
+            assert node.attrs["int8_input_scale"] > 0
+    assert_allclose(model.predict(X), reference.predict(X), atol=0.02)
+
+
+def test_quantize_int8_serialization():
+    model, X = make_dense_model(Linear(16, 16), Softmax(5, 16))
+    quantize_int8(model)
+    model_bytes = model.to_bytes()
+    loaded, _ = make_dense_model(Linear(16, 16), Softmax(5, 16))
+    loaded.from_bytes(model_bytes)
+    assert loaded.layers[0].get_param("W_int8").dtype == "int8"
+    assert_allclose(loaded.predict(X), model.predict(X))
+
+
+def test_quantize_int8_multisoftmax():
+    model = MultiSoftmax((2, 3), 4)
+    model.initialize()
+    W = numpy.random.uniform(-1, 1, model.get_param("W").shape).astype("f")
+    model.set_param("W", W)
+    X = numpy.random.uniform(-1, 1, (6, 4)).astype("f")
+    expected = model.predict(X)
+    quantize_int8(model)
+    Y = model.predict(X)
+    assert_allclose(Y, expected, atol=0.02)
+    assert_allclose(Y[:, :2].sum(axis=1), 1.0, rtol=1e-5)
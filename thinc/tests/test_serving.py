@@ -0,0 +1,93 @@
+import asyncio
+import threading
+import pytest
+import numpy
+from numpy.testing import assert_allclose
+from thinc.api import BatchingExecutor, Relu, with_array, Ragged, Model
+
+
+def _make_model():
+    model = Relu(4, 3)
+    model.initialize()
+    return model
+
+
+def test_batching_executor_threads():
+    model = with_array(_make_model())
+    Xs = [numpy.random.uniform(-1, 1, (i + 1, 3)).astype("f") for i in range(20)]
+    results = [None] * len(Xs)
+    with BatchingExecutor(model, max_batch_size=8, max_latency=0.05) as executor:
+
+        def run(i):
+            results[i] = executor.predict(Xs[i])
+
+        threads = [threading.Thread(target=run, args=(i,)) for i in range(len(Xs))]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        histograms = executor.get_histograms()
+    for X, Y in zip(Xs, results):
+        assert_allclose(Y, model.predict([X])[0], rtol=1e-5)
+    batch_sizes = histograms["batch_size"]
+    assert sum(size * count for size, count in batch_sizes.items()) == len(Xs)
+    assert max(batch_sizes) <= 8
+    assert max(batch_sizes) > 1
+    assert sum(histograms["queue_depth"].values()) == sum(batch_sizes.values())
+
+
+@pytest.mark.parametrize("batch_type", ["array", "ragged"])
+def test_batching_executor_asyncio(batch_type):
+    model = with_array(_make_model()) if batch_type == "ragged" else _make_model()
+    Xs = [numpy.random.uniform(-1, 1, (i + 1, 3)).astype("f") for i in range(6)]
+
+    async def run(executor):
+        return await asyncio.gather(*[executor.apredict(X) for X in Xs])
+
+    with BatchingExecutor(model, max_latency=0.05, batch_type=batch_type) as executor:
+        results = asyncio.run(run(executor))
+    for X, Y in zip(Xs, results):
+        if batch_type == "ragged":
+            expected = model.predict(Ragged(X, numpy.asarray([len(X)], dtype="i")))
+            expected = expected.dataXd
+        else:
+            expected = model.predict(X)
+        assert_allclose(Y, expected, rtol=1e-5)
+
+
+def test_batching_executor_cancelled():
+    futures = []
+    cancelled_while_running = []
+
+    def forward(model, X, is_train):
+        # Clients try to cancel their inputs while the batch is predicted.
+        cancelled_while_running.extend(future.cancel() for future in futures[1:])
+        return X * 2, lambda dY: dY
+
+    model = Model("double", forward)
+    Xs = [numpy.full((1, 3), i, dtype="f") for i in range(4)]
+    executor = BatchingExecutor(
+        model, max_batch_size=4, max_latency=1.0, batch_type="array"
+    )
+    with executor:
+        futures.extend(executor.submit(X) for X in Xs)
+        assert futures[0].cancel()
+        for X, future in zip(Xs[1:], futures[1:]):
+            assert_allclose(future.result(timeout=5), X * 2)
+        assert cancelled_while_running == [False, False, False]
+        # The worker thread is still alive.
+        X = numpy.ones((2, 3), dtype="f")
+        assert_allclose(executor.submit(X).result(timeout=5), X * 2)
+    assert executor.get_histograms()["batch_size"] == {1: 1, 4: 1}
+
+
+def test_batching_executor_errors():
+    model = _make_model()
+    with BatchingExecutor(model, batch_type="array") as executor:
+        with pytest.raises(ValueError):
+            executor.predict(numpy.zeros((2, 5), dtype="f"))
+        assert executor.predict(numpy.zeros((2, 3), dtype="f")).shape == (2, 4)
+    with pytest.raises(ValueError):
+        executor.submit(numpy.zeros((2, 3), dtype="f"))
+    with pytest.raises(ValueError):
+        BatchingExecutor(model, batch_type="padded")
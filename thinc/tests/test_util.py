@@ -2,7 +2,7 @@ import pytest
 import numpy
 from thinc.api import get_width, Ragged, Padded
 from thinc.util import get_array_module, is_numpy_array, to_categorical
-from thinc.util import convert_recursive
+from thinc.util import convert_recursive, format_bytes
 from thinc.types import ArgsKwargs
 
 
@@ -75,3 +75,17 @@ def test_convert_recursive():
     result = convert_recursive(is_match, convert_item, obj)
     assert result["a"].args == ("FOO", [{"b": "FOO"}])
     assert result["a"].kwargs == {"a": ["x", "FOO"]}
+
+
+@pytest.mark.parametrize(
+    "n_bytes,expected",
+    [
+        (0, "0 B"),
+        (1023, "1023 B"),
+        (1536, "1.5 KB"),
+        (-2048, "-2.0 KB"),
+        (3 << 30, "3.0 GB"),
+    ],
+)
+def test_format_bytes(n_bytes, expected):
+    assert format_bytes(n_bytes) == expected
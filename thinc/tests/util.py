@@ -2,7 +2,7 @@ import contextlib
 from pathlib import Path
 import tempfile
 import shutil
-from thinc.api import Linear, Ragged, Padded, ArgsKwargs
+from thinc.api import Linear, Ragged, Padded, ArgsKwargs, Maxout, Relu, chain
 import numpy
 import pytest
 
@@ -24,6 +24,21 @@ def get_model(W_b_input, cls=Linear):
     return model
 
 
+def make_dense_model(*layers):
+    """Get a chain of Maxout and Relu layers followed by `layers`, initialized
+    on a batch of random inputs, and the batch. Weights that are initialized
+    to zero, e.g. by Softmax, are randomized.
+    """
+    model = chain(Maxout(16, 12, nP=3), Relu(16, 16), *layers)
+    X = numpy.random.uniform(-1, 1, (20, 12)).astype("f")
+    model.initialize(X=X)
+    for node in model.walk():
+        if node.has_param("W") and not node.get_param("W").any():
+            shape = node.get_param("W").shape
+            node.set_param("W", numpy.random.uniform(-1, 1, shape).astype("f"))
+    return model, X
+
+
 def get_shape(W_b_input):
     W, b, input_ = W_b_input
     return input_.shape[0], W.shape[0], W.shape[1]
@@ -31,6 +31,8 @@ Shape = Tuple[int, ...]
 DTypes = Literal["f", "i", "float16", "float32", "float64", "int32", "int64", "uint32", "uint64"]
 DTypesFloat = Literal["f", "float32", "float16", "float64"]
 DTypesInt = Literal["i", "int32", "int64", "uint32", "uint64"]
+# bfloat16 values are stored in uint16 arrays, as numpy has no bfloat16 type.
+FloatStorage = Literal["float32", "float16", "bfloat16"]
 
 Array1d = Union["Floats1d", "Ints1d"]
 Array2d = Union["Floats2d", "Ints2d"]
@@ -421,6 +421,15 @@ def validate_fwd_input_output(
         raise DataValidationError(name, X, Y, e.errors())
 
 
+def format_bytes(n_bytes: float) -> str:
+    """Format a number of bytes for display, e.g. "1.5 MB"."""
+    for unit in ("B", "KB", "MB"):
+        if abs(n_bytes) < 1024:
+            return f"{n_bytes:.0f} {unit}" if unit == "B" else f"{n_bytes:.1f} {unit}"
+        n_bytes /= 1024
+    return f"{n_bytes:.1f} GB"
+
+
 @contextlib.contextmanager
 def make_tempfile(mode="r"):
     f = tempfile.NamedTemporaryFile(mode=mode, delete=False)